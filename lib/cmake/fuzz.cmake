@@ -0,0 +1,48 @@
+
+#
+# Generates a source file with a FUZZ_CORPUS for each file in corpus_dir (e.g: a corpus saved by libFuzzer), so the
+# corpus is replayed through the FUZZ_TEST named test_name when the tests run, on any platform.
+# Adding, removing or changing files in the directory regenerates the source file on the next build.
+#
+function(czmut_fuzz_corpus output_file test_name corpus_dir)
+	file(GLOB _files CONFIGURE_DEPENDS LIST_DIRECTORIES false "${corpus_dir}/*")
+	list(SORT _files)
+	set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${_files})
+
+	set(_content "// Generated by czmut_fuzz_corpus from ${corpus_dir}\n")
+	string(APPEND _content "#include <crazygaze/mut/mut.h>\n")
+
+	foreach(_file IN LISTS _files)
+		get_filename_component(_name "${_file}" NAME)
+		string(REPLACE "\\" "\\\\" _name "${_name}")
+		string(REPLACE "\"" "\\\"" _name "${_name}")
+		string(APPEND _content "\nFUZZ_CORPUS(\"${test_name}\", \"${_name}\"")
+
+		# 16 bytes per line
+		file(READ "${_file}" _hex HEX)
+		string(LENGTH "${_hex}" _len)
+		set(_pos 0)
+		set(_lines "")
+		while(_pos LESS _len)
+			string(SUBSTRING "${_hex}" ${_pos} 32 _line)
+			string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " _line "${_line}")
+			string(REGEX REPLACE ", $" "" _line "${_line}")
+			list(APPEND _lines "${_line}")
+			math(EXPR _pos "${_pos} + 32")
+		endwhile()
+
+		if(_lines)
+			string(JOIN ",\n\t" _bytes ${_lines})
+			string(APPEND _content ",\n\t${_bytes}")
+		endif()
+		string(APPEND _content ")\n")
+	endforeach()
+
+	# Only writing if something changed, so it doesn't trigger a rebuild every time cmake runs
+	if(EXISTS "${output_file}")
+		file(READ "${output_file}" _old)
+	endif()
+	if(NOT "${_old}" STREQUAL "${_content}")
+		file(WRITE "${output_file}" "${_content}")
+	endif()
+endfunction()
@@ -0,0 +1,127 @@
+
+# Cached, so it is visible to callers in other directories
+set(CZMUT_PARTITION_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/partition_script.cmake" CACHE INTERNAL "")
+
+#
+# Splits a test suite into as few firmware images as fit the specified flash and RAM budgets.
+#
+# czmut_partition(<name>
+#	SOURCES <file>...
+#	TAGS <tag>...
+#	FLASH_BUDGET <bytes>
+#	RAM_BUDGET <bytes>
+#	[LINK_LIBRARIES <library>...]
+#	[BASE_IMAGE <target>]
+#	[SIZE_TOOL <path>]
+#	[PIO_EXTENDS <section>])
+#
+# Each tag is a group of tests that goes into the same image (e.g: "[gpio]"). Every test should have exactly one of the
+# tags, otherwise it's either in no image, or in more than one.
+# To catch tests that are in no image, the sources are also compiled with all the tags, and with all the tests. If the
+# sizes differ, partitioning fails. A test with more than one of the tags can't be detected that way, and runs in more
+# than one image.
+# The sources are compiled once per tag with CZMUT_COMPILE_TIME_TAGS set to that tag, and once with no tests. The
+# difference in size is each tag's footprint. Since this measures object files before linking, it's an upper bound.
+# If BASE_IMAGE is specified (an executable with no tests), its size is subtracted from the budgets, otherwise the
+# budgets are only for the tests.
+#
+# Building the "<name>_partition" target bin-packs the tags into images (first fit decreasing), and generates in the
+# current binary directory:
+#	<name>_partitions.json : Manifest with the images in the order to run them, their tags, and footprints
+#	<name>_partitions.cmake : Sets <name>_PARTITION_COUNT, and <name>_PARTITION_<N>_TAGS (1 based) with the value of
+#		CZMUT_COMPILE_TIME_TAGS for each image. Include it (OPTIONAL) to create a target per image.
+#	<name>_partitions.ini : A PlatformIO environment per image, extending PIO_EXTENDS if specified.
+#
+function(czmut_partition name)
+	cmake_parse_arguments(PARSE_ARGV 1 ARG "" "FLASH_BUDGET;RAM_BUDGET;BASE_IMAGE;SIZE_TOOL;PIO_EXTENDS" "SOURCES;TAGS;LINK_LIBRARIES")
+
+	if(NOT ARG_SOURCES OR NOT ARG_TAGS OR NOT ARG_FLASH_BUDGET OR NOT ARG_RAM_BUDGET)
+		message(FATAL_ERROR "czmut_partition: SOURCES, TAGS, FLASH_BUDGET and RAM_BUDGET are required")
+	endif()
+
+	if(NOT ARG_LINK_LIBRARIES)
+		set(ARG_LINK_LIBRARIES czmut)
+	endif()
+
+	if(NOT ARG_SIZE_TOOL)
+		if(CMAKE_SIZE)
+			set(ARG_SIZE_TOOL "${CMAKE_SIZE}")
+		else()
+			find_program(CZMUT_PARTITION_SIZE_TOOL NAMES size llvm-size)
+			set(ARG_SIZE_TOOL "${CZMUT_PARTITION_SIZE_TOOL}")
+		endif()
+	endif()
+
+	if(NOT ARG_SIZE_TOOL)
+		message(WARNING "czmut_partition: No size tool found, so '${name}' can't be partitioned")
+		return()
+	endif()
+
+	# The script gets its input from a file, since the tags don't survive being passed as a list on the command line
+	set(input "set(NAME \"${name}\")\n")
+	string(APPEND input "set(SIZE_TOOL \"${ARG_SIZE_TOOL}\")\n")
+	string(APPEND input "set(FLASH_BUDGET ${ARG_FLASH_BUDGET})\n")
+	string(APPEND input "set(RAM_BUDGET ${ARG_RAM_BUDGET})\n")
+	string(APPEND input "set(PIO_EXTENDS \"${ARG_PIO_EXTENDS}\")\n")
+	string(APPEND input "set(OUTPUT_DIR \"${CMAKE_CURRENT_BINARY_DIR}\")\n")
+	if(ARG_BASE_IMAGE)
+		string(APPEND input "set(BASE_IMAGE \"$<TARGET_FILE:${ARG_BASE_IMAGE}>\")\n")
+	endif()
+
+	set(libs "")
+	set(count 0)
+	# Index 0 is the library with no tests. The tag can't match anything
+	foreach(tag IN ITEMS "[czmut:none]" ${ARG_TAGS})
+		if(tag MATCHES "[,\"\\\\]")
+			message(FATAL_ERROR "czmut_partition: Tag ${tag} can't contain commas, quotes or backslashes")
+		endif()
+
+		set(lib "${name}_partition_${count}")
+		add_library(${lib} STATIC EXCLUDE_FROM_ALL ${ARG_SOURCES})
+		target_compile_definitions(${lib} PRIVATE "CZMUT_COMPILE_TIME_TAGS=\"${tag}\"")
+		target_link_libraries(${lib} ${ARG_LINK_LIBRARIES})
+		set_target_properties(${lib} PROPERTIES FOLDER "partition/${name}")
+		list(APPEND libs ${lib})
+
+		string(APPEND input "set(TAG_${count} \"${tag}\")\n")
+		string(APPEND input "set(LIB_${count} \"$<TARGET_FILE:${lib}>\")\n")
+		math(EXPR count "${count} + 1")
+	endforeach()
+
+	math(EXPR count "${count} - 1")
+	string(APPEND input "set(TAG_COUNT ${count})\n")
+
+	# All the tags, and all the tests. Any difference is tests that don't have any of the tags
+	string(JOIN "," all_tags ${ARG_TAGS})
+	foreach(check IN ITEMS "tags" "tests")
+		set(lib "${name}_partition_all_${check}")
+		add_library(${lib} STATIC EXCLUDE_FROM_ALL ${ARG_SOURCES})
+		if(check STREQUAL "tags")
+			target_compile_definitions(${lib} PRIVATE "CZMUT_COMPILE_TIME_TAGS=\"${all_tags}\"")
+		else()
+			target_compile_definitions(${lib} PRIVATE "CZMUT_COMPILE_TIME_TAGS=\"\"")
+		endif()
+		target_link_libraries(${lib} ${ARG_LINK_LIBRARIES})
+		set_target_properties(${lib} PROPERTIES FOLDER "partition/${name}")
+		list(APPEND libs ${lib})
+	endforeach()
+	string(APPEND input "set(ALL_TAGS \"${all_tags}\")\n")
+	string(APPEND input "set(LIB_ALL_TAGS \"$<TARGET_FILE:${name}_partition_all_tags>\")\n")
+	string(APPEND input "set(LIB_ALL_TESTS \"$<TARGET_FILE:${name}_partition_all_tests>\")\n")
+
+	set(input_file "${CMAKE_CURRENT_BINARY_DIR}/${name}_partition_input_$<CONFIG>.cmake")
+	file(GENERATE OUTPUT "${input_file}" CONTENT "${input}")
+
+	add_custom_target(${name}_partition
+		COMMAND ${CMAKE_COMMAND} "-DINPUT=${input_file}" -P "${CZMUT_PARTITION_SCRIPT}"
+		DEPENDS "${CZMUT_PARTITION_SCRIPT}"
+		BYPRODUCTS
+			"${CMAKE_CURRENT_BINARY_DIR}/${name}_partitions.json"
+			"${CMAKE_CURRENT_BINARY_DIR}/${name}_partitions.cmake"
+			"${CMAKE_CURRENT_BINARY_DIR}/${name}_partitions.ini"
+		COMMENT "Partitioning '${name}' into images of ${ARG_FLASH_BUDGET} bytes of flash and ${ARG_RAM_BUDGET} bytes of RAM"
+		VERBATIM
+	)
+	add_dependencies(${name}_partition ${libs} ${ARG_BASE_IMAGE})
+	set_target_properties(${name}_partition PROPERTIES FOLDER "partition/${name}")
+endfunction()
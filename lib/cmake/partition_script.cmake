@@ -0,0 +1,172 @@
+#
+# Script mode (cmake -P) part of czmut_partition. Measures the footprint of each tag, bin-packs the tags into images,
+# and writes the manifest and the generated files.
+#
+# Expected variables:
+#	INPUT : File generated by czmut_partition, which sets the following
+#		NAME
+#		SIZE_TOOL : Path to a binutils compatible "size" tool
+#		FLASH_BUDGET, RAM_BUDGET : Bytes available in each image
+#		BASE_IMAGE : Optional. Executable with no tests, whose size is subtracted from the budgets
+#		PIO_EXTENDS : Optional. PlatformIO section the generated environments extend
+#		OUTPUT_DIR
+#		TAG_COUNT
+#		TAG_<N>, LIB_<N> : For N in [0, TAG_COUNT]. Index 0 is the library with no tests
+#		ALL_TAGS : All the tags, separated by commas
+#		LIB_ALL_TAGS, LIB_ALL_TESTS : Libraries with all the tags, and with all the tests
+#
+
+include("${INPUT}")
+include("${CMAKE_CURRENT_LIST_DIR}/size.cmake")
+
+set(flash_budget ${FLASH_BUDGET})
+set(ram_budget ${RAM_BUDGET})
+if(BASE_IMAGE)
+	czmut_get_size("${SIZE_TOOL}" "${BASE_IMAGE}" base_image_flash base_image_ram)
+	math(EXPR flash_budget "${flash_budget} - ${base_image_flash}")
+	math(EXPR ram_budget "${ram_budget} - ${base_image_ram}")
+else()
+	set(base_image_flash 0)
+	set(base_image_ram 0)
+endif()
+
+#
+# Tests without any of the tags wouldn't be in any image
+#
+czmut_get_size("${SIZE_TOOL}" "${LIB_ALL_TAGS}" all_tags_flash all_tags_ram)
+czmut_get_size("${SIZE_TOOL}" "${LIB_ALL_TESTS}" all_tests_flash all_tests_ram)
+if(NOT all_tags_flash EQUAL all_tests_flash OR NOT all_tags_ram EQUAL all_tests_ram)
+	message(FATAL_ERROR "Some tests don't have any of the tags, so they wouldn't be in any image. All the tags take "
+		"${all_tags_flash} bytes of flash and ${all_tags_ram} bytes of RAM, but all the tests take ${all_tests_flash} bytes of "
+		"flash and ${all_tests_ram} bytes of RAM. Tags: ${ALL_TAGS}")
+endif()
+
+#
+# Footprint of each tag
+#
+czmut_get_size("${SIZE_TOOL}" "${LIB_0}" base_flash base_ram)
+set(remaining "")
+foreach(i RANGE 1 ${TAG_COUNT})
+	czmut_get_size("${SIZE_TOOL}" "${LIB_${i}}" flash ram)
+	math(EXPR flash_${i} "${flash} - ${base_flash}")
+	math(EXPR ram_${i} "${ram} - ${base_ram}")
+
+	# Compiler noise can make a tag with no tests slightly negative
+	if(flash_${i} LESS 0)
+		set(flash_${i} 0)
+	endif()
+	if(ram_${i} LESS 0)
+		set(ram_${i} 0)
+	endif()
+
+	if(flash_${i} GREATER flash_budget OR ram_${i} GREATER ram_budget)
+		message(FATAL_ERROR "Tests with tag ${TAG_${i}} need ${flash_${i}} bytes of flash and ${ram_${i}} bytes of RAM, "
+			"which doesn't fit in the budget of ${flash_budget} bytes of flash and ${ram_budget} bytes of RAM")
+	endif()
+
+	list(APPEND remaining ${i})
+endforeach()
+
+#
+# First fit decreasing: Takes the tags from biggest to smallest (by flash, then RAM), and puts each one in the first
+# image with space for it, adding a new image if none has.
+#
+set(image_count 0)
+while(remaining)
+	list(GET remaining 0 biggest)
+	foreach(i IN LISTS remaining)
+		if(flash_${i} GREATER flash_${biggest} OR
+			(flash_${i} EQUAL flash_${biggest} AND ram_${i} GREATER ram_${biggest}))
+			set(biggest ${i})
+		endif()
+	endforeach()
+	list(REMOVE_ITEM remaining ${biggest})
+
+	set(target 0)
+	if(image_count GREATER 0)
+		foreach(image RANGE 1 ${image_count})
+			math(EXPR flash "${image_flash_${image}} + ${flash_${biggest}}")
+			math(EXPR ram "${image_ram_${image}} + ${ram_${biggest}}")
+			if(NOT flash GREATER flash_budget AND NOT ram GREATER ram_budget)
+				set(target ${image})
+				break()
+			endif()
+		endforeach()
+	endif()
+
+	if(target EQUAL 0)
+		math(EXPR image_count "${image_count} + 1")
+		set(target ${image_count})
+		set(image_flash_${target} 0)
+		set(image_ram_${target} 0)
+		set(image_tags_${target} "")
+	endif()
+
+	math(EXPR image_flash_${target} "${image_flash_${target}} + ${flash_${biggest}}")
+	math(EXPR image_ram_${target} "${image_ram_${target}} + ${ram_${biggest}}")
+	list(APPEND image_tags_${target} ${biggest})
+endwhile()
+
+#
+# Output
+#
+set(json "{\n")
+string(APPEND json "\t\"name\": \"${NAME}\",\n")
+string(APPEND json "\t\"flashBudget\": ${FLASH_BUDGET},\n")
+string(APPEND json "\t\"ramBudget\": ${RAM_BUDGET},\n")
+string(APPEND json "\t\"baseImageFlash\": ${base_image_flash},\n")
+string(APPEND json "\t\"baseImageRam\": ${base_image_ram},\n")
+string(APPEND json "\t\"images\": [")
+
+set(cmake_content "# Generated by czmut_partition. Do not edit.\n")
+string(APPEND cmake_content "set(${NAME}_PARTITION_COUNT ${image_count})\n")
+
+set(ini "; Generated by czmut_partition. One environment per image, to build and run in sequence.\n")
+
+foreach(image RANGE 1 ${image_count})
+	set(compile_time_tags "")
+	set(tags_json "")
+	foreach(i IN LISTS image_tags_${image})
+		if(compile_time_tags)
+			string(APPEND compile_time_tags ",")
+			string(APPEND tags_json ",")
+		endif()
+		string(APPEND compile_time_tags "${TAG_${i}}")
+		string(APPEND tags_json "\n\t\t\t\t{ \"tag\": \"${TAG_${i}}\", \"flash\": ${flash_${i}}, \"ram\": ${ram_${i}} }")
+	endforeach()
+
+	if(image GREATER 1)
+		string(APPEND json ",")
+	endif()
+	string(APPEND json "\n\t\t{\n")
+	string(APPEND json "\t\t\t\"image\": ${image},\n")
+	string(APPEND json "\t\t\t\"compileTimeTags\": \"${compile_time_tags}\",\n")
+	string(APPEND json "\t\t\t\"flash\": ${image_flash_${image}},\n")
+	string(APPEND json "\t\t\t\"ram\": ${image_ram_${image}},\n")
+	string(APPEND json "\t\t\t\"tags\": [${tags_json}\n\t\t\t]\n")
+	string(APPEND json "\t\t}")
+
+	string(APPEND cmake_content "set(${NAME}_PARTITION_${image}_TAGS \"${compile_time_tags}\")\n")
+
+	string(APPEND ini "\n[env:${NAME}_part${image}]\n")
+	if(PIO_EXTENDS)
+		string(APPEND ini "extends = ${PIO_EXTENDS}\n")
+	endif()
+	string(APPEND ini "build_flags = '-DCZMUT_COMPILE_TIME_TAGS=\"${compile_time_tags}\"'\n")
+
+	message(STATUS "${NAME} image ${image}: ${compile_time_tags} (${image_flash_${image}} bytes of flash, ${image_ram_${image}} bytes of RAM)")
+endforeach()
+
+string(APPEND json "\n\t]\n}\n")
+
+file(WRITE "${OUTPUT_DIR}/${NAME}_partitions.json" "${json}")
+file(WRITE "${OUTPUT_DIR}/${NAME}_partitions.ini" "${ini}")
+
+# Only writing if something changed, since including it from CMakeLists.txt makes cmake re-run when it changes
+set(cmake_file "${OUTPUT_DIR}/${NAME}_partitions.cmake")
+if(EXISTS "${cmake_file}")
+	file(READ "${cmake_file}" old_content)
+endif()
+if(NOT "${old_content}" STREQUAL "${cmake_content}")
+	file(WRITE "${cmake_file}" "${cmake_content}")
+endif()
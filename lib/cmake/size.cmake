@@ -0,0 +1,30 @@
+
+#
+# Gets the flash (text + data) and RAM (data + bss) footprint of a library or executable, with a binutils compatible
+# "size" tool. Libraries are the sum of all their object files.
+# Usable from script mode (cmake -P) too.
+#
+function(czmut_get_size size_tool file out_flash out_ram)
+	execute_process(
+		COMMAND ${size_tool} "${file}"
+		OUTPUT_VARIABLE output
+		RESULT_VARIABLE result)
+
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "Failed to run '${size_tool}' on ${file}")
+	endif()
+
+	# Berkeley format. One line per object file, with text, data, bss as the first 3 columns
+	set(flash 0)
+	set(ram 0)
+	string(REPLACE "\n" ";" lines "${output}")
+	foreach(line IN LISTS lines)
+		if(line MATCHES "^[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)")
+			math(EXPR flash "${flash} + ${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+			math(EXPR ram "${ram} + ${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+		endif()
+	endforeach()
+
+	set(${out_flash} ${flash} PARENT_SCOPE)
+	set(${out_ram} ${ram} PARENT_SCOPE)
+endfunction()
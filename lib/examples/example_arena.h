@@ -0,0 +1,51 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+#if CZMUT_HAS_PMR
+	#include <vector>
+#endif
+
+/*
+TestArena gives tests cheap scratch memory without using the heap.
+The arena is rewound at the end of every pass through the test, and the peak usage of the test is logged.
+*/
+TEST_CASE("A test using the test arena", "[example][arena]")
+{
+	int* values = static_cast<int*>(cz::mut::TestArena::allocate(sizeof(int) * 8, alignof(int)));
+	REQUIRE(values != nullptr);
+	for (int i = 0; i < 8; i++)
+	{
+		values[i] = i;
+	}
+
+	SECTION("section A")
+	{
+		CHECK(values[7] == 7);
+	}
+
+	SECTION("section B")
+	{
+		int* other = cz::mut::TestArena::create<int>(10);
+		CHECK(*other + values[1] == 11);
+		cz::mut::TestArena::destroy(other);
+	}
+
+#if CZMUT_HAS_PMR
+	// On desktop platforms, the arena can also be used with std::pmr containers
+	SECTION("section C")
+	{
+		std::pmr::vector<int> vec(cz::mut::TestArena::getResource());
+		vec.push_back(1);
+		vec.push_back(2);
+		CHECK(vec.size() == 2);
+	}
+#endif
+
+	// Not strictly necessary, since the arena is rewound anyway, but freeing everything means no leaks are reported
+	cz::mut::TestArena::deallocate(values, sizeof(int) * 8);
+	CHECK(cz::mut::TestArena::getLiveAllocations() == 0);
+}
@@ -0,0 +1,74 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	// Pretend these are set by an interrupt handler or a DMA completion callback
+	cz::mut::SimulatedEvent gExampleTransferDone;
+	cz::mut::SimulatedEvent gExampleTimerFired;
+}
+
+/*
+An async test is a resumable function. While it waits, the runner advances other tests.
+Local variables don't keep their values across waits, so any state needs to be static (or global).
+The last parameter is a timeout in milliseconds (0 means no timeout).
+*/
+ASYNC_TEST_CASE("An async test waiting for a transfer", "[example][async]", 1000)
+{
+	static int transfers;
+
+	ASYNC_BEGIN();
+
+	transfers = 0;
+	gExampleTransferDone.fireAfterPolls(3);
+	ASYNC_WAIT_UNTIL(gExampleTransferDone.isSet());
+	transfers++;
+
+	gExampleTransferDone.fireAfterPolls(2);
+	ASYNC_WAIT_UNTIL(gExampleTransferDone.isSet());
+	transfers++;
+
+	CHECK(transfers == 2);
+
+	ASYNC_END();
+}
+
+ASYNC_TEST_CASE("An async test waiting for a timer", "[example][async]", 1000)
+{
+	ASYNC_BEGIN();
+
+	gExampleTimerFired.fireAfterMs(5);
+	ASYNC_WAIT_UNTIL(gExampleTimerFired.isSet());
+
+	// Lets the runner do other things before we continue
+	ASYNC_YIELD();
+
+	ASYNC_WAIT_MS(2);
+	CHECK(gExampleTimerFired.isSet());
+
+	ASYNC_END();
+}
+
+#if CZMUT_COROUTINES
+/*
+With C++20, async tests can also be coroutines, which can keep local variables across waits.
+*/
+COROUTINE_TEST_CASE("A coroutine test", "[example][async]", 1000)
+{
+	cz::mut::SimulatedEvent event;
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		event.fireAfterPolls(2);
+		co_await cz::mut::waitUntil([&event]() { return event.isSet(); });
+		count++;
+	}
+
+	co_await cz::mut::waitMs(1);
+	CHECK(count == 3);
+}
+#endif
@@ -11,3 +11,21 @@ TEST_CASE("Very simple test", "[example][basic]")
 	// If dummy is not 1, this will cause the test to fail and stop here
 	CHECK(dummy==1);
 }
+
+TEST_CASE("Formatting", "[example][basic]")
+{
+	// CZMUT_FORMAT is the same as CZMUT_LOG, but writes to a buffer, like snprintf
+	char buf[32];
+	CHECK(CZMUT_FORMAT(buf, sizeof(buf), "%d %s", 10, "apples") == 9);
+	CHECK(strcmp(buf, "10 apples") == 0);
+
+	// %u and %x of negative values show the same bits as printf, which promotes types smaller than int to int
+	CZMUT_FORMAT(buf, sizeof(buf), "%x %X %x", int8_t(-1), int16_t(-2), int32_t(-1));
+	CHECK(strcmp(buf, sizeof(int) == 4 ? "ffffffff FFFFFFFE ffffffff" : "ffff FFFE ffffffff") == 0);
+	CZMUT_FORMAT(buf, sizeof(buf), "%u %d", int32_t(-1), int32_t(-1));
+	CHECK(strcmp(buf, "4294967295 -1") == 0);
+
+	// The output is truncated to fit
+	CHECK(CZMUT_FORMAT(buf, 4, "%d", 123456) == 3);
+	CHECK(strcmp(buf, "123") == 0);
+}
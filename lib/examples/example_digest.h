@@ -0,0 +1,54 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	constexpr int ImageWidth = 32;
+	constexpr int ImageHeight = 16;
+
+	// Renders one row of a diagonal gradient
+	void renderRow(uint8_t* row, int y)
+	{
+		for (int x = 0; x < ImageWidth; x++)
+		{
+			row[x] = static_cast<uint8_t>((x + y) * 255 / (ImageWidth + ImageHeight - 2));
+		}
+	}
+}
+
+/*
+Instead of keeping a copy of the expected output, a digest test only keeps its CRC32.
+To update the expected values after an intended change, run the tests with the record mode enabled (e.g: set the
+CZMUT_RECORD_DIGESTS environment variable to 1), and rebuild.
+*/
+TEST_CASE("Digest", "[example][digest]")
+{
+	SECTION("Whole buffer")
+	{
+		uint8_t image[ImageWidth * ImageHeight];
+		for (int y = 0; y < ImageHeight; y++)
+		{
+			renderRow(image + y * ImageWidth, y);
+		}
+
+		CHECK_DIGEST(image, sizeof(image), 0x76D59EC1);
+	}
+
+	// Only one row is in memory at a time, and the digest is the same as for the whole buffer
+	SECTION("Streaming")
+	{
+		cz::mut::Digest digest;
+		uint8_t row[ImageWidth];
+		for (int y = 0; y < ImageHeight; y++)
+		{
+			renderRow(row, y);
+			digest.update(row, sizeof(row));
+		}
+
+		CHECK_DIGEST_STREAM(digest, 0x76D59EC1);
+	}
+}
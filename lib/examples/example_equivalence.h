@@ -0,0 +1,59 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	// Straightforward version, one bit at a time
+	int countBitsReference(const uint8_t* data, int size)
+	{
+		int count = 0;
+		for (int i = 0; i < size; i++)
+		{
+			for (int bit = 0; bit < 8; bit++)
+			{
+				count += (data[i] >> bit) & 1;
+			}
+		}
+		return count;
+	}
+
+	// Faster version, one nibble at a time with a lookup table
+	int countBitsOptimized(const uint8_t* data, int size)
+	{
+		static const uint8_t nibbleBits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+		int count = 0;
+		for (int i = 0; i < size; i++)
+		{
+			count += nibbleBits[data[i] & 0xF] + nibbleBits[data[i] >> 4];
+		}
+		return count;
+	}
+}
+
+/*
+An equivalence test feeds the same inputs to a reference and an optimized implementation, checks they give the same
+results, and times both.
+The speedup depends on the compiler and optimization level (an optimizer can do a lot with the reference version), so
+this one only logs it (MinSpeedup 0). A real test would set a minimum speedup for the build it targets.
+*/
+EQUIVALENCE_TEST("Count bits", "[example][equivalence]", countBitsReference, countBitsOptimized, 0)
+{
+	uint8_t buf[64];
+	uint32_t seed = 1;
+	for (int i = 0; i < 100; i++)
+	{
+		for (uint8_t& b : buf)
+		{
+			seed = seed * 1664525 + 1013904223;
+			b = static_cast<uint8_t>(seed >> 24);
+		}
+		CHECK_EQUIVALENT(buf, i % 65);
+	}
+
+	memset(buf, 0xFF, sizeof(buf));
+	CHECK_EQUIVALENT(buf, 64);
+}
@@ -0,0 +1,50 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	int gExampleFixtureInstances = 0;
+
+	struct ExampleFixture
+	{
+		ExampleFixture()
+		{
+			gExampleFixtureInstances++;
+			values[0] = 1;
+			values[1] = 2;
+		}
+
+		~ExampleFixture()
+		{
+			gExampleFixtureInstances--;
+		}
+
+		int values[2];
+	};
+}
+
+/*
+The fixture is constructed before each pass through the test, and destroyed after it, so each section gets a fresh
+fixture. The test's body is a member function of a class derived from the fixture, so it has direct access to the
+fixture's members.
+*/
+TEST_CASE_METHOD(ExampleFixture, "A test case with a fixture", "[example][fixtures]")
+{
+	CHECK(gExampleFixtureInstances == 1);
+
+	SECTION("section A")
+	{
+		values[0] = 10;
+		CHECK(values[0] + values[1] == 12);
+	}
+
+	// Fresh fixture, so values[0] is 1 again
+	SECTION("section B")
+	{
+		CHECK(values[0] + values[1] == 3);
+	}
+}
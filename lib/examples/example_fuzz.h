@@ -0,0 +1,78 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	// Decodes an unsigned LEB128 value (7 bits per byte, with the top bit set if more bytes follow).
+	// Returns the number of bytes used, or 0 if the input is truncated or doesn't fit in 32 bits.
+	size_t decodeVarint(const uint8_t* data, size_t size, uint32_t& value)
+	{
+		value = 0;
+		for (size_t i = 0; i < size && i < 5; i++)
+		{
+			if (i == 4 && (data[i] & 0xF0))
+			{
+				return 0;
+			}
+
+			value |= static_cast<uint32_t>(data[i] & 0x7F) << (i * 7);
+			if ((data[i] & 0x80) == 0)
+			{
+				return i + 1;
+			}
+		}
+
+		return 0;
+	}
+
+	size_t encodeVarint(uint32_t value, uint8_t* out)
+	{
+		size_t len = 0;
+		do
+		{
+			out[len] = value & 0x7F;
+			value >>= 7;
+			if (value)
+			{
+				out[len] |= 0x80;
+			}
+			len++;
+		} while (value);
+
+		return len;
+	}
+}
+
+/*
+A fuzz target gets its input as "data" and "size".
+When the tests run, it's called once for each FUZZ_CORPUS entry with the same name.
+With CZMUT_FUZZ (and clang's -fsanitize=fuzzer), libFuzzer calls it with generated inputs instead, and saves any input
+that fails an assertion. Those inputs can then be added to the corpus, so they keep being tested on all platforms.
+*/
+FUZZ_TEST("Varint round trip", "[example][fuzz]")
+{
+	uint32_t value;
+	size_t used = decodeVarint(data, size, value);
+	CHECK(used <= size);
+	if (used)
+	{
+		uint8_t encoded[5];
+		size_t len = encodeVarint(value, encoded);
+		// Encodings with redundant zeros (e.g: 0x80 0x00) are valid, so the canonical encoding can be shorter
+		CHECK(len <= used);
+		uint32_t decoded;
+		CHECK(decodeVarint(encoded, len, decoded) == len);
+		CHECK(decoded == value);
+	}
+}
+
+FUZZ_CORPUS("Varint round trip", "empty")
+FUZZ_CORPUS("Varint round trip", "one byte", 0x05)
+FUZZ_CORPUS("Varint round trip", "two bytes", 0xAC, 0x02)
+FUZZ_CORPUS("Varint round trip", "truncated", 0x80)
+FUZZ_CORPUS("Varint round trip", "redundant zeros", 0x80, 0x80, 0x00)
+FUZZ_CORPUS("Varint round trip", "too big", 0xFF, 0xFF, 0xFF, 0xFF, 0x1F)
@@ -0,0 +1,24 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+/*
+INFO and CAPTURE add context to any failed assertion in the same scope.
+Nothing is formatted or logged unless an assertion fails, so they are cheap to use in loops.
+*/
+TEST_CASE("A test with context", "[example][info]")
+{
+	INFO("Checking squares");
+	for (int i = 0; i < 100; i++)
+	{
+		int square = i * i;
+		CAPTURE(i, square);
+		// If this failed, the log would include:
+		//     INFO: Checking squares
+		//     CAPTURE: i, square := <value of i>, <value of square>
+		CHECK(square >= i);
+	}
+}
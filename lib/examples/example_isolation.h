@@ -0,0 +1,66 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+// Only available on POSIX desktop platforms (see cz::mut::runIsolated)
+#if CZMUT_ISOLATION
+
+#include <signal.h>
+
+/*
+These tests crash on purpose, so they don't have the [example] tag, and only run with runIsolated. The example program
+runs them with --isolation-example, in batches of 4 entries:
+	- The first batch crashes in "Isolation crash after others", because of what "Isolation bad state" left behind.
+	  On its own, it doesn't crash, so it's reported as only crashing after other tests. "Isolation crash" didn't run
+	  yet, so it runs again in a new batch, where it crashes on its own.
+	- The second batch crashes in "Isolation failed REQUIRE", which crashes on its own too. "Isolation after crashes"
+	  runs again in a new batch, and passes.
+*/
+namespace
+{
+	bool gIsolationBadState = false;
+}
+
+TEST_CASE("Isolation pass", "[isolation]")
+{
+	CHECK(true);
+}
+
+TEST_CASE("Isolation bad state", "[isolation]")
+{
+	// Something that leaves the process in a bad state, like a dangling pointer
+	gIsolationBadState = true;
+	CHECK(true);
+}
+
+TEST_CASE("Isolation crash after others", "[isolation]")
+{
+	if (gIsolationBadState)
+	{
+		raise(SIGSEGV);
+	}
+	CHECK(true);
+}
+
+TEST_CASE("Isolation crash", "[isolation]")
+{
+	SECTION("null pointer")
+	{
+		raise(SIGSEGV);
+	}
+}
+
+TEST_CASE("Isolation failed REQUIRE", "[isolation]")
+{
+	REQUIRE(gIsolationBadState);
+}
+
+TEST_CASE("Isolation after crashes", "[isolation]")
+{
+	CHECK(true);
+}
+
+#endif
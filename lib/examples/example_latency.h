@@ -0,0 +1,65 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	// Stand-in for a packet handler, where every 100th packet takes the slow path
+	unsigned long handlePacket(int packet)
+	{
+		unsigned long checksum = 0;
+		int work = (packet % 100) == 0 ? 2000 : 20;
+		for (int i = 0; i < work; i++)
+		{
+			checksum = checksum * 31 + static_cast<unsigned long>(i ^ packet);
+		}
+		return checksum;
+	}
+}
+
+/*
+Averages hide the slow cases. A latency histogram records every call, and the checks are on percentiles.
+*/
+TEST_CASE("Latency", "[example][latency]")
+{
+	cz::mut::LatencyHistogram<> histogram;
+
+	SECTION("Measured")
+	{
+		volatile unsigned long sink = 0;
+		for (int packet = 0; packet < 1000; packet++)
+		{
+			cz::mut::ScopedLatency latency(histogram);
+			sink = sink + handlePacket(packet);
+		}
+
+		histogram.log(F("handlePacket"));
+		CHECK(histogram.getCount() == 1000);
+		// Generous limits, since the examples can run on a busy machine
+		CHECK_LATENCY_P50(histogram, <= 1000);
+		CHECK_LATENCY_P99(histogram, <= 5000);
+	}
+
+	SECTION("Recorded values")
+	{
+		// 990 fast values, and 10 slow ones
+		for (unsigned long i = 0; i < 990; i++)
+		{
+			histogram.record(10 + i % 5);
+		}
+		for (unsigned long i = 0; i < 10; i++)
+		{
+			histogram.record(500);
+		}
+
+		CHECK_LATENCY_P50(histogram, <= 15);
+		CHECK_LATENCY_P99(histogram, <= 15);
+		// Values are recorded with an error of at most 12.5%
+		CHECK_LATENCY_P999(histogram, >= 500);
+		CHECK_LATENCY_P999(histogram, <= 500 + 500 / 8);
+		CHECK_LATENCY_MAX(histogram, == 500);
+	}
+}
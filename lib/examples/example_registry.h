@@ -0,0 +1,52 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+/*
+A library's own suite, which the example program runs with cz::mut::run(cz::mut::registries::example_lib).
+Normally, the library's test files set CZMUT_REGISTRY before including mut.h (or with a compile definition), and
+CZMUT_DEFINE_REGISTRY goes in one of the library's cpp files. Here everything is in the same file, so CZMUT_REGISTRY is
+switched back to the global registry at the end.
+See src/registry for a library built as a static library, whose tests are only linked if the registry is used.
+*/
+CZMUT_DECLARE_REGISTRY(example_lib)
+
+#undef CZMUT_REGISTRY
+#define CZMUT_REGISTRY example_lib
+
+namespace
+{
+	int exampleLibClamp(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+}
+
+TEST_CASE("Library clamp", "[example][registry]")
+{
+	CHECK(exampleLibClamp(5, 0, 10) == 5);
+	CHECK(exampleLibClamp(-5, 0, 10) == 0);
+	CHECK(exampleLibClamp(15, 0, 10) == 10);
+}
+
+TEMPLATED_TEST_CASE("Library clamp types", "[example][registry]", short, long)
+{
+	CHECK(exampleLibClamp(static_cast<TestType>(20), 0, 10) == 10);
+}
+
+#undef CZMUT_REGISTRY
+#define CZMUT_REGISTRY global
+
+CZMUT_DEFINE_REGISTRY(example_lib)
+
+// This one is in the global registry, so it runs with the other examples
+TEST_CASE("Registries", "[example][registry]")
+{
+	// The example program ran the library's suite first, which only selected its registry while it ran
+	CHECK(&cz::mut::getRegistry() == &cz::mut::registries::global);
+	// The library's tests are not part of the global registry
+	CHECK(cz::mut::registries::example_lib.getCount() == 2);
+}
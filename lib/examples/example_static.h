@@ -0,0 +1,39 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace
+{
+	constexpr uint32_t exampleCrc32(const char* str)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		while (*str)
+		{
+			crc ^= (unsigned char)*str++;
+			for (int i = 0; i < 8; i++)
+				crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+		return ~crc;
+	}
+
+	// 16.16 fixed point
+	constexpr int32_t exampleToFixed(int value)
+	{
+		return (int32_t)value * 65536;
+	}
+}
+
+/*
+The checks are evaluated at compile time, so a failure is a compile error.
+The test doesn't take any flash or RAM besides what's needed to count it in the final report.
+Define CZMUT_STATIC_TESTS_AT_RUNTIME to 1 to run it as a normal test instead.
+*/
+STATIC_TEST_CASE("A static test case", "[example][static]")
+{
+	STATIC_CHECK(exampleCrc32("123456789") == 0xCBF43926);
+	STATIC_CHECK(exampleToFixed(1) == 0x10000);
+	STATIC_REQUIRE(exampleToFixed(-2) == -0x20000);
+}
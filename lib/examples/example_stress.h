@@ -0,0 +1,60 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+// Only available on platforms with thread support (enabled by default on desktop platforms)
+#if CZMUT_THREADS
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	// A minimal spin lock, to hammer with cz::mut::stress
+	class SpinLock
+	{
+	public:
+		void lock()
+		{
+			while (m_locked.exchange(true, std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		void unlock()
+		{
+			m_locked.store(false, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<bool> m_locked {false};
+	};
+}
+
+TEST_CASE("Stress a spin lock", "[example][stress]")
+{
+	SpinLock lock;
+	unsigned long counter = 0;
+	std::atomic<int> inside(0);
+
+	// Each of the 4 threads runs the function 10000 times
+	cz::mut::StressResult result = cz::mut::stress(4, 10000, [&](int /*thread*/, unsigned long /*iteration*/)
+	{
+		lock.lock();
+		CHECK(inside.fetch_add(1) == 0);
+		// Gives other threads the chance to run in the middle of the critical section
+		cz::mut::stressYield();
+		counter++;
+		inside.fetch_sub(1);
+		lock.unlock();
+	});
+
+	CHECK(result.passed());
+	CHECK(counter == 4 * 10000);
+}
+
+#endif
@@ -15,3 +15,14 @@ TEMPLATED_TEST_CASE("A templated test case", "[example][templated]", char, int)
 	CZMUT_LOG("Size of TestType=%d\n", sizeof(dummy));
 }
 
+
+/*
+A list of types can be shared by any number of tests.
+*/
+using ExampleNumeric = cz::mut::TypeList<int8_t, uint16_t, int32_t, float, double>;
+
+TEMPLATED_TEST_CASE("A templated test case with a type list", "[example][templated]", ExampleNumeric)
+{
+	TestType value = 7;
+	CHECK(value + value == static_cast<TestType>(14));
+}
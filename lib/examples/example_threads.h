@@ -0,0 +1,35 @@
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+// Only available on platforms with thread support (enabled by default on desktop platforms)
+#if CZMUT_THREADS
+
+#include <thread>
+#include <atomic>
+
+TEST_CASE("A test using threads", "[example][threads]")
+{
+	std::atomic<int> counter(0);
+
+	// CHECK and REQUIRE can be used from any thread. Any failures are attributed to the test that is running.
+	auto worker = [&counter]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			CHECK(counter.fetch_add(1) >= 0);
+		}
+	};
+
+	std::thread a(worker);
+	std::thread b(worker);
+	a.join();
+	b.join();
+
+	CHECK(counter == 2000);
+}
+
+#endif
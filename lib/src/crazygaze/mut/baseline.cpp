@@ -0,0 +1,304 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#if CZMUT_BASELINES
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cz::mut
+{
+
+namespace
+{
+
+// Increase this if the file format changes in a way older versions can't read
+constexpr int BaselineVersion = 1;
+constexpr const char* BaselineHeader = "czmut-baseline";
+
+struct PassStats
+{
+	uint64_t medianNs = 0;
+	uint64_t madNs = 0;
+	int samples = 0;
+};
+
+// Key is "test name<type name>/section/section"
+std::map<std::string, std::vector<uint64_t>> gSamples;
+
+void onPassTiming(const detail::TestCase* test, const __FlashStringHelper* typeName, const detail::Section* leaf, uint64_t durationNs)
+{
+	std::string key = reinterpret_cast<const char*>(test->getName());
+	if (typeName)
+	{
+		key += '<';
+		key += reinterpret_cast<const char*>(typeName);
+		key += '>';
+	}
+
+	// The root section is not part of the path
+	std::string path;
+	for (const detail::Section* section = leaf; section && section->getParent(); section = section->getParent())
+	{
+		path.insert(0, reinterpret_cast<const char*>(section->getName()));
+		path.insert(0, 1, '/');
+	}
+
+	gSamples[key + path].push_back(durationNs);
+}
+
+uint64_t median(std::vector<uint64_t>& values)
+{
+	std::sort(values.begin(), values.end());
+	size_t mid = values.size() / 2;
+	return (values.size() % 2) ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+PassStats calcStats(std::vector<uint64_t> samples)
+{
+	PassStats stats;
+	stats.samples = static_cast<int>(samples.size());
+	stats.medianNs = median(samples);
+	// Median absolute deviation. Unlike the standard deviation, it's not thrown off by the odd outlier (e.g: the OS
+	// scheduling something else in the middle of a pass)
+	for (uint64_t& sample : samples)
+	{
+		sample = sample > stats.medianNs ? sample - stats.medianNs : stats.medianNs - sample;
+	}
+	stats.madNs = median(samples);
+	return stats;
+}
+
+/*
+* Runs the tests (warmup + samples) times, and calculates the stats of each pass
+*/
+bool collect(const char* tags, const BaselineOptions& options, std::map<std::string, PassStats>& results)
+{
+	if (options.samples < 1)
+	{
+		CZMUT_LOG("BASELINE: Needs at least 1 sample\n");
+		return false;
+	}
+
+	Verbosity oldVerbosity = getVerbosity();
+	if (oldVerbosity > Verbosity::Failures)
+	{
+		setVerbosity(Verbosity::Failures);
+	}
+
+	bool passed = true;
+	for (int i = 0; i < options.warmup && passed; i++)
+	{
+		passed = run(tags);
+	}
+
+	gSamples.clear();
+	detail::gPassTimingHook = onPassTiming;
+	for (int i = 0; i < options.samples && passed; i++)
+	{
+		passed = run(tags);
+	}
+	detail::gPassTimingHook = nullptr;
+
+	setVerbosity(oldVerbosity);
+
+	if (!passed)
+	{
+		CZMUT_LOG("BASELINE: Tests failed\n");
+		gSamples.clear();
+		return false;
+	}
+
+	for (auto& [key, samples] : gSamples)
+	{
+		results[key] = calcStats(samples);
+	}
+	gSamples.clear();
+
+	return true;
+}
+
+/*
+* File format (text, one pass per line, sorted by key):
+*
+* czmut-baseline <version>
+* <median ns> <median absolute deviation ns> <number of samples> <key>
+*
+* The key is last, since it can contain spaces.
+*/
+bool writeBaseline(const char* file, const std::map<std::string, PassStats>& results)
+{
+	FILE* f = fopen(file, "w");
+	if (!f)
+	{
+		CZMUT_LOG("BASELINE: Can't write to file %s\n", file);
+		return false;
+	}
+
+	fprintf(f, "%s %d\n", BaselineHeader, BaselineVersion);
+	for (const auto& [key, stats] : results)
+	{
+		fprintf(f, "%llu %llu %d %s\n", (unsigned long long)stats.medianNs, (unsigned long long)stats.madNs, stats.samples, key.c_str());
+	}
+
+	bool ok = ferror(f) == 0;
+	ok = (fclose(f) == 0) && ok;
+	if (!ok)
+	{
+		CZMUT_LOG("BASELINE: Error writing to file %s\n", file);
+	}
+	return ok;
+}
+
+bool readBaseline(const char* file, std::map<std::string, PassStats>& results)
+{
+	FILE* f = fopen(file, "r");
+	if (!f)
+	{
+		CZMUT_LOG("BASELINE: Can't read file %s\n", file);
+		return false;
+	}
+
+	char header[32];
+	int version = 0;
+	if (fscanf(f, "%31s %d", header, &version) != 2 || strcmp(header, BaselineHeader) != 0)
+	{
+		CZMUT_LOG("BASELINE: %s is not a baseline file\n", file);
+		fclose(f);
+		return false;
+	}
+
+	if (version > BaselineVersion)
+	{
+		CZMUT_LOG("BASELINE: %s has version %d, but only up to version %d is supported\n", file, version, BaselineVersion);
+		fclose(f);
+		return false;
+	}
+
+	bool ok = true;
+	unsigned long long medianNs;
+	unsigned long long madNs;
+	int samples;
+	while (fscanf(f, "%llu %llu %d ", &medianNs, &madNs, &samples) == 3)
+	{
+		std::string key;
+		int ch;
+		while ((ch = fgetc(f)) != EOF && ch != '\n')
+		{
+			key += static_cast<char>(ch);
+		}
+
+		if (key.empty())
+		{
+			ok = false;
+			break;
+		}
+
+		PassStats& stats = results[key];
+		stats.medianNs = medianNs;
+		stats.madNs = madNs;
+		stats.samples = samples;
+	}
+
+	if (!ok || !feof(f))
+	{
+		CZMUT_LOG("BASELINE: %s is malformed\n", file);
+		ok = false;
+	}
+
+	fclose(f);
+	return ok;
+}
+
+} // anonymous namespace
+
+bool recordBaseline(const char* tags, const char* file, const BaselineOptions& options)
+{
+	std::map<std::string, PassStats> results;
+	if (!collect(tags, options, results) || !writeBaseline(file, results))
+	{
+		CZMUT_LOG("**** BASELINE FAILED ****\n");
+		return false;
+	}
+
+	CZMUT_LOG("BASELINE: %d passes recorded to %s\n", static_cast<int>(results.size()), file);
+	CZMUT_LOG("**** BASELINE SUCCESS ****\n");
+	return true;
+}
+
+bool compareBaseline(const char* tags, const char* file, const BaselineOptions& options)
+{
+	std::map<std::string, PassStats> baseline;
+	std::map<std::string, PassStats> results;
+	if (!readBaseline(file, baseline) || !collect(tags, options, results))
+	{
+		CZMUT_LOG("**** BASELINE FAILED ****\n");
+		return false;
+	}
+
+	int compared = 0;
+	int regressions = 0;
+	int improvements = 0;
+	int added = 0;
+	for (const auto& [key, stats] : results)
+	{
+		auto it = baseline.find(key);
+		if (it == baseline.end())
+		{
+			added++;
+			if (getVerbosity() >= Verbosity::Normal)
+			{
+				CZMUT_LOG("BASELINE NEW: [%s] %llu ns\n", key.c_str(), (unsigned long long)stats.medianNs);
+			}
+			continue;
+		}
+
+		compared++;
+		const PassStats& base = it->second;
+		double diff = static_cast<double>(stats.medianNs) - static_cast<double>(base.medianNs);
+		double noise = options.noiseFactor * static_cast<double>(std::max(stats.madNs, base.madNs));
+		double limit = std::max({ options.threshold * static_cast<double>(base.medianNs), noise, options.minDifferenceNs });
+		double change = base.medianNs ? diff * 100 / static_cast<double>(base.medianNs) : 0;
+
+		if (diff > limit)
+		{
+			regressions++;
+			if (getVerbosity() >= Verbosity::Failures)
+			{
+				CZMUT_LOG("BASELINE REGRESSION: [%s] %llu ns, baseline %llu ns (%+.1f%%)\n",
+					key.c_str(), (unsigned long long)stats.medianNs, (unsigned long long)base.medianNs, change);
+			}
+		}
+		else if (-diff > limit)
+		{
+			improvements++;
+			if (getVerbosity() >= Verbosity::Normal)
+			{
+				CZMUT_LOG("BASELINE IMPROVEMENT: [%s] %llu ns, baseline %llu ns (%+.1f%%)\n",
+					key.c_str(), (unsigned long long)stats.medianNs, (unsigned long long)base.medianNs, change);
+			}
+		}
+		else if (getVerbosity() >= Verbosity::Verbose)
+		{
+			CZMUT_LOG("BASELINE: [%s] %llu ns, baseline %llu ns (%+.1f%%)\n",
+				key.c_str(), (unsigned long long)stats.medianNs, (unsigned long long)base.medianNs, change);
+		}
+	}
+
+	CZMUT_LOG("BASELINE: %d passes compared. %d regressions. %d improvements. %d new passes.\n", compared, regressions, improvements, added);
+	if (regressions)
+	{
+		CZMUT_LOG("**** BASELINE FAILED ****\n");
+		return false;
+	}
+
+	CZMUT_LOG("**** BASELINE SUCCESS ****\n");
+	return true;
+}
+
+} // namespace cz::mut
+
+#endif
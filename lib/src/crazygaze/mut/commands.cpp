@@ -0,0 +1,278 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#include <stdlib.h>
+
+namespace cz::mut
+{
+
+namespace detail
+{
+
+struct CommandAccess
+{
+	// Logs the ID, name and tags of the tests selected by the tag expression, followed by the static tests, which
+	// runtime filtering doesn't apply to
+	static void list(FlashStringIterator tags)
+	{
+		if (!TestCase::filter(tags))
+		{
+			return;
+		}
+
+		int id = 1;
+		int count = 0;
+		for (TestCase* test = TestCase::getFirst(); test; test = test->m_next, id++)
+		{
+			if (test->m_enabled)
+			{
+				logN(F("#"), id, F(" "), test->m_name, F(" "), test->m_tags, F("\n"));
+				count++;
+			}
+		}
+
+		int staticCount = 0;
+		for (const StaticTestInfo* test = firstStaticTest(); test; test = nextStaticTest(test))
+		{
+			logN(F("static "), reinterpret_cast<const __FlashStringHelper*>(test->name), F(" "),
+				reinterpret_cast<const __FlashStringHelper*>(test->tags), F("\n"));
+			staticCount++;
+		}
+
+		logN(count, F(" tests, "), staticCount, F(" static tests\n"));
+	}
+};
+
+} // namespace detail
+
+namespace
+{
+
+struct CommandState
+{
+	char line[CZMUT_COMMAND_BUFFER_SIZE];
+	int len;
+	// Set if the line didn't fit in the buffer, so the rest of it is discarded
+	bool overflow;
+	// Set while a run started by a "run" command is in progress
+	bool running;
+	bool ready;
+} gCommands;
+
+void logReady()
+{
+	logN(F("READY\n"));
+	flushlog();
+}
+
+/*
+* If the line starts with the specified command, moves "line" to the command's arguments (skipping any spaces) and
+* returns true
+*/
+bool matchCommand(const char*& line, const __FlashStringHelper* command)
+{
+	detail::FlashStringIterator it(command);
+	const char* ptr = line;
+	while (*it)
+	{
+		if (*ptr != *it)
+		{
+			return false;
+		}
+		++ptr;
+		++it;
+	}
+
+	if (*ptr != 0 && *ptr != ' ')
+	{
+		return false;
+	}
+
+	while (*ptr == ' ')
+	{
+		ptr++;
+	}
+	line = ptr;
+	return true;
+}
+
+// An empty tag expression means all tests
+detail::FlashStringIterator tagsArg(const char* args)
+{
+	return detail::FlashStringIterator::fromRam(*args ? args : nullptr);
+}
+
+/*
+* Executes a command. Returns false if it was "quit"
+*/
+bool execute(const char* line)
+{
+	const char* args = line;
+	if (*line == 0)
+	{
+		// Nothing to do
+	}
+	else if (matchCommand(args, F("help")))
+	{
+		logN(F("Commands:\n"));
+		logN(F("  list [tags]            Lists the tests selected by the tag expression (all if not specified)\n"));
+		logN(F("  run [tags]             Runs the tests selected by the tag expression\n"));
+		logN(F("  repeat <count> [tags]  Runs the tests repeatedly (see cz::mut::runRepeat)\n"));
+		logN(F("  summary                Logs the results of the last run\n"));
+		logN(F("  verbosity <0-3>        Sets the verbosity (quiet, failures, normal, verbose)\n"));
+		logN(F("  quit\n"));
+	}
+	else if (matchCommand(args, F("list")))
+	{
+		detail::CommandAccess::list(tagsArg(args));
+	}
+	else if (matchCommand(args, F("run")))
+	{
+		gCommands.running = detail::beginRun(tagsArg(args));
+		if (gCommands.running)
+		{
+			// READY is logged once the run finishes
+			return true;
+		}
+	}
+	else if (matchCommand(args, F("repeat")))
+	{
+		char* end;
+		unsigned long count = strtoul(args, &end, 10);
+		while (*end == ' ')
+		{
+			end++;
+		}
+
+		if (count == 0)
+		{
+			logN(F("COMMAND: repeat needs a count\n"));
+		}
+		else
+		{
+			detail::runRepeat(tagsArg(end), count, 0, false);
+		}
+	}
+	else if (matchCommand(args, F("summary")))
+	{
+		detail::logFinalResults();
+	}
+	else if (matchCommand(args, F("verbosity")))
+	{
+		int verbosity = atoi(args);
+		if (*args < '0' || *args > '9' || verbosity > CZMUT_VERBOSITY_VERBOSE)
+		{
+			logN(F("COMMAND: Invalid verbosity\n"));
+		}
+		else
+		{
+			setVerbosity(static_cast<Verbosity>(verbosity));
+		}
+	}
+	else if (matchCommand(args, F("quit")))
+	{
+		return false;
+	}
+	else
+	{
+		logN(F("COMMAND: Unknown command: "), line, F("\n"));
+	}
+
+	logReady();
+	return true;
+}
+
+/*
+* Adds a character to the line, and executes the line once complete.
+* Returns false if the command was "quit"
+*/
+bool processChar(char ch)
+{
+	if (ch == '\r')
+	{
+		return true;
+	}
+
+	if (ch != '\n')
+	{
+		if (gCommands.len + 1 < CZMUT_COMMAND_BUFFER_SIZE)
+		{
+			gCommands.line[gCommands.len++] = ch;
+		}
+		else
+		{
+			gCommands.overflow = true;
+		}
+		return true;
+	}
+
+	gCommands.line[gCommands.len] = 0;
+	gCommands.len = 0;
+	if (gCommands.overflow)
+	{
+		gCommands.overflow = false;
+		logN(F("COMMAND: Line too long\n"));
+		logReady();
+		return true;
+	}
+
+	return execute(gCommands.line);
+}
+
+} // anonymous namespace
+
+bool pollCommands()
+{
+	if (!gCommands.ready)
+	{
+		gCommands.ready = true;
+		logReady();
+	}
+
+	if (gCommands.running)
+	{
+		if (!step())
+		{
+			gCommands.running = false;
+			logReady();
+		}
+		return true;
+	}
+
+#if CZMUT_ARDUINO
+	// Only what is already available, so it doesn't block. A run started by a command starts on the next call
+	while (CZMUT_SERIAL.available() > 0 && !gCommands.running)
+	{
+		if (!processChar(static_cast<char>(CZMUT_SERIAL.read())))
+		{
+			return false;
+		}
+	}
+	return true;
+#else
+	// A whole line at a time
+	int ch;
+	while ((ch = getchar()) != EOF)
+	{
+		if (!processChar(static_cast<char>(ch)))
+		{
+			return false;
+		}
+
+		if (ch == '\n')
+		{
+			return true;
+		}
+	}
+
+	// The input ended, but the last line might not end with a new line. If it started a run, it still needs polling
+	if (gCommands.len)
+	{
+		return processChar('\n') && gCommands.running;
+	}
+	return false;
+#endif
+}
+
+} // namespace cz::mut
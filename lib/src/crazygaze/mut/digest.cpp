@@ -0,0 +1,168 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#if CZMUT_DIGEST_RECORDING
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#if CZMUT_THREADS
+	#include <mutex>
+#endif
+
+namespace cz::mut
+{
+
+namespace
+{
+
+// -1 means it wasn't set yet, and the environment variable decides
+int gRecordDigests = -1;
+
+#if CZMUT_THREADS
+// Checks can come from the test's threads, and two of them could be rewriting the same file
+std::mutex gRecordMutex;
+#endif
+
+// How many lines after the reported one are searched, since the check's arguments can span several lines
+constexpr int MaxDigestLines = 10;
+
+bool isIdentifierChar(char ch)
+{
+	return isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '.';
+}
+
+/*
+* Finds the last integer literal in the line with the specified value.
+* Sets "start" and "end" to the literal's digits (the suffix, if any, is not included)
+*/
+bool findLiteral(const std::string& line, uint32_t value, size_t& start, size_t& end)
+{
+	bool found = false;
+	for (size_t pos = 0; pos < line.size(); pos++)
+	{
+		if (!isdigit(static_cast<unsigned char>(line[pos])) || (pos > 0 && isIdentifierChar(line[pos - 1])))
+		{
+			continue;
+		}
+
+		char* literalEnd;
+		unsigned long long literal = strtoull(line.c_str() + pos, &literalEnd, 0);
+		size_t digitsEnd = literalEnd - line.c_str();
+		size_t suffixEnd = digitsEnd;
+		while (suffixEnd < line.size() && strchr("uUlL", line[suffixEnd]))
+		{
+			suffixEnd++;
+		}
+
+		// Anything else right after the digits means it's not an integer literal (e.g: 1.5f)
+		if ((suffixEnd == line.size() || !isIdentifierChar(line[suffixEnd])) && literal == value)
+		{
+			start = pos;
+			end = digitsEnd;
+			found = true;
+		}
+
+		pos = suffixEnd;
+	}
+
+	return found;
+}
+
+} // anonymous namespace
+
+void setDigestRecording(bool enabled)
+{
+	gRecordDigests = enabled ? 1 : 0;
+}
+
+namespace detail
+{
+
+bool isRecordingDigests()
+{
+	if (gRecordDigests == -1)
+	{
+		const char* env = getenv("CZMUT_RECORD_DIGESTS");
+		gRecordDigests = (env && strcmp(env, "1") == 0) ? 1 : 0;
+	}
+	return gRecordDigests == 1;
+}
+
+bool recordDigest(const char* file, int line, uint32_t expected, uint32_t digest)
+{
+#if CZMUT_THREADS
+	std::lock_guard<std::mutex> lock(gRecordMutex);
+#endif
+
+	FILE* f = fopen(file, "rb");
+	if (!f)
+	{
+		CZMUT_LOG("DIGEST: Can't read file %s\n", file);
+		return false;
+	}
+
+	// Keeping the line endings, so the file is written back exactly as it was, except for the literal
+	std::vector<std::string> lines(1);
+	int ch;
+	while ((ch = fgetc(f)) != EOF)
+	{
+		lines.back() += static_cast<char>(ch);
+		if (ch == '\n')
+		{
+			lines.emplace_back();
+		}
+	}
+	fclose(f);
+
+	size_t start = 0;
+	size_t end = 0;
+	int index = line - 1;
+	for (; index >= 0 && index < static_cast<int>(lines.size()) && index < line - 1 + MaxDigestLines; index++)
+	{
+		if (findLiteral(lines[index], expected, start, end))
+		{
+			break;
+		}
+	}
+
+	if (index < 0 || index >= static_cast<int>(lines.size()) || index >= line - 1 + MaxDigestLines)
+	{
+		// This also happens if a check in a loop gets different digests, since the first one already replaced the
+		// literal
+		CZMUT_LOG("DIGEST: Can't find the expected value at %s:%d\n", file, line);
+		return false;
+	}
+
+	char literal[16];
+	snprintf(literal, sizeof(literal), "0x%08lX", static_cast<unsigned long>(digest));
+	lines[index].replace(start, end - start, literal);
+
+	f = fopen(file, "wb");
+	if (!f)
+	{
+		CZMUT_LOG("DIGEST: Can't write to file %s\n", file);
+		return false;
+	}
+
+	for (const std::string& str : lines)
+	{
+		fwrite(str.data(), 1, str.size(), f);
+	}
+
+	bool ok = ferror(f) == 0;
+	ok = (fclose(f) == 0) && ok;
+	if (!ok)
+	{
+		CZMUT_LOG("DIGEST: Error writing to file %s\n", file);
+	}
+	return ok;
+}
+
+} // namespace detail
+
+} // namespace cz::mut
+
+#endif
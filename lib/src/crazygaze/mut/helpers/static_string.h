@@ -88,4 +88,23 @@ namespace cz::mut
 				: contains(where.subString(1), what);
 	}
 
+	// Position of the first "c" in "str", or the size of "str" if not found
+	static constexpr int find(StaticString str, char c, int pos = 0)
+	{
+		return pos == str.size()
+			? pos
+			: str.begin()[pos] == c
+				? pos
+				: find(str, c, pos + 1);
+	}
+
+	// Checks if "where" contains any of the comma separated strings in "what"
+	static constexpr bool containsAny(StaticString where, StaticString what)
+	{
+		return find(what, ',') == what.size()
+			? contains(where, what)
+			: contains(where, StaticString(what.begin(), find(what, ',')))
+				|| containsAny(where, StaticString(what.begin() + find(what, ',') + 1, what.size() - find(what, ',') - 1));
+	}
+
 }
\ No newline at end of file
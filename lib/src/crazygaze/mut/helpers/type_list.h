@@ -0,0 +1,100 @@
+#pragma once
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define CZMUT_PRETTY_FUNCTION __FUNCSIG__
+#else
+	#define CZMUT_PRETTY_FUNCTION __PRETTY_FUNCTION__
+#endif
+
+namespace cz::mut
+{
+	/*
+	* A list of types for TEMPLATED_TEST_CASE, that can be shared by any number of tests. E.g:
+	*	using Numeric = cz::mut::TypeList<int8_t, int16_t, int32_t, float>;
+	*/
+	template<typename... Types>
+	struct TypeList
+	{
+	};
+}
+
+namespace cz::mut::detail
+{
+	// The types given to TEMPLATED_TEST_CASE, which can be a list of types, or a single TypeList
+	template<typename... Types>
+	struct TypeListOfImpl
+	{
+		using Type = TypeList<Types...>;
+	};
+
+	template<typename... Types>
+	struct TypeListOfImpl<TypeList<Types...>>
+	{
+		using Type = TypeList<Types...>;
+	};
+
+	template<typename... Types>
+	using TypeListOf = typename TypeListOfImpl<Types...>::Type;
+
+	//
+	// Type names, taken at compile time from the signature of a function template instantiated for the type.
+	// The signature itself is only used in constant expressions, so only the name ends up in the binary.
+	//
+	template<typename T>
+	constexpr StaticString typeNameSource()
+	{
+		return StaticString(CZMUT_PRETTY_FUNCTION);
+	}
+
+	// Position of "what" in "where", or -1 if not found
+	constexpr int findString(StaticString where, StaticString what)
+	{
+		for (int i = 0; i + what.size() <= where.size(); i++)
+		{
+			int j = 0;
+			while (j < what.size() && where.begin()[i + j] == what.begin()[j])
+			{
+				j++;
+			}
+
+			if (j == what.size())
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// What comes before and after the type in the signature is the same for any type, so a known type tells us where
+	// the type is
+	constexpr int TypeNamePrefix = findString(typeNameSource<double>(), "double");
+	constexpr int TypeNameSuffix = typeNameSource<double>().size() - TypeNamePrefix - 6;
+	static_assert(TypeNamePrefix > 0, "Can't get type names from this compiler's function signatures");
+
+	template<int Size>
+	struct TypeNameChars
+	{
+		constexpr TypeNameChars(const char* src)
+		{
+			for (int i = 0; i < Size; i++)
+			{
+				data[i] = src[i];
+			}
+		}
+
+		char data[Size + 1] {};
+	};
+
+	template<typename T>
+	struct TypeName
+	{
+		// One copy per type, no matter how many tests use it
+		static constexpr TypeNameChars<typeNameSource<T>().size() - TypeNamePrefix - TypeNameSuffix> chars PROGMEM {
+			typeNameSource<T>().begin() + TypeNamePrefix };
+
+		static const __FlashStringHelper* get()
+		{
+			return reinterpret_cast<const __FlashStringHelper*>(chars.data);
+		}
+	};
+}
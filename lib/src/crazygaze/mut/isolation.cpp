@@ -0,0 +1,490 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#if CZMUT_ISOLATION
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+
+namespace cz::mut
+{
+
+namespace detail
+{
+
+IsolatedBatch gIsolatedBatch;
+
+struct IsolationAccess
+{
+	struct EntryInfo
+	{
+		const TestCase* test;
+		const __FlashStringHelper* typeName;
+	};
+
+	static bool filter(const char* tags)
+	{
+		return TestCase::filter(FlashStringIterator(tags));
+	}
+
+	// Entries of the enabled tests, in the order they run. Also counts the entries of the disabled tests
+	static std::vector<EntryInfo> getEnabledEntries(int& skipped)
+	{
+		std::vector<EntryInfo> entries;
+		skipped = 0;
+		for (TestCase* test = TestCase::getFirst(); test; test = test->m_next)
+		{
+			if (!test->m_enabled)
+			{
+				skipped += test->m_numEntries;
+				continue;
+			}
+
+			for (int i = 0; i < test->m_numEntries; i++)
+			{
+				entries.push_back({test, test->m_entries[i].typeName});
+			}
+		}
+		return entries;
+	}
+
+	static void runBatch()
+	{
+		TestCase::begin();
+		while (TestCase::step())
+		{
+		}
+	}
+};
+
+} // namespace detail
+
+namespace
+{
+
+using detail::IsolationAccess;
+
+// Sent from the child process to the parent. Small enough for writes to a pipe to be atomic
+struct Message
+{
+	enum class Type : uint8_t
+	{
+		EntryStart,
+		Section,
+		EntryEnd,
+		Done
+	};
+
+	Type type;
+	// Position of the entry (EntryStart and EntryEnd)
+	int entry;
+	// Name of the section the child is in, or nullptr if it's in no section (Section)
+	const __FlashStringHelper* section;
+	// Accumulated results in the child (EntryEnd and Done)
+	detail::Results results;
+};
+
+void sendMessage(int fd, const Message& msg)
+{
+	const char* ptr = reinterpret_cast<const char*>(&msg);
+	size_t todo = sizeof(msg);
+	while (todo)
+	{
+		ssize_t res = write(fd, ptr, todo);
+		if (res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (res <= 0)
+		{
+			return;
+		}
+		ptr += res;
+		todo -= res;
+	}
+}
+
+bool receiveMessage(int fd, Message& msg)
+{
+	char* ptr = reinterpret_cast<char*>(&msg);
+	size_t todo = sizeof(msg);
+	while (todo)
+	{
+		ssize_t res = read(fd, ptr, todo);
+		if (res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (res <= 0)
+		{
+			return false;
+		}
+		ptr += res;
+		todo -= res;
+	}
+	return true;
+}
+
+/*
+* Reports the progress of the child process to the parent.
+* The child is a copy of the parent, so pointers (e.g: section names) are valid in the parent too.
+*/
+class ChildListener final : public Listener
+{
+public:
+	ChildListener(int fd, int firstEntry)
+		: m_fd(fd)
+		, m_nextEntry(firstEntry)
+	{
+	}
+
+	void onEntryStart(const detail::TestCase& test, const __FlashStringHelper* typeName) override
+	{
+		// Async entries can finish in a different order, so keeping track of which one is which
+		m_running.push_back({&test, typeName, m_nextEntry});
+		send(Message::Type::EntryStart, m_nextEntry++, nullptr);
+	}
+
+	void onEntryEnd(const detail::TestCase& test, const __FlashStringHelper* typeName) override
+	{
+		for (auto it = m_running.begin(); it != m_running.end(); ++it)
+		{
+			if (it->test == &test && it->typeName == typeName)
+			{
+				int entry = it->entry;
+				m_running.erase(it);
+				send(Message::Type::EntryEnd, entry, nullptr);
+				return;
+			}
+		}
+	}
+
+	void onSectionEnter(const detail::Section& section) override
+	{
+		send(Message::Type::Section, 0, section.getName());
+	}
+
+	void onSectionExit(const detail::Section& section) override
+	{
+		send(Message::Type::Section, 0, section.getParent() ? section.getParent()->getName() : nullptr);
+	}
+
+	void done()
+	{
+		send(Message::Type::Done, 0, nullptr);
+	}
+
+private:
+	void send(Message::Type type, int entry, const __FlashStringHelper* section)
+	{
+		Message msg = {};
+		msg.type = type;
+		msg.entry = entry;
+		msg.section = section;
+		if (type == Message::Type::EntryEnd || type == Message::Type::Done)
+		{
+			detail::mergeThreadCounters();
+			msg.results = detail::gResults;
+		}
+		sendMessage(m_fd, msg);
+	}
+
+	struct RunningEntry
+	{
+		const detail::TestCase* test;
+		const __FlashStringHelper* typeName;
+		int entry;
+	};
+
+	int m_fd;
+	int m_nextEntry;
+	std::vector<RunningEntry> m_running;
+};
+
+struct Batch
+{
+	int first;
+	int last;
+	// If set, this entry crashed when it ran with others, and is now running on its own
+	bool retry;
+	int status;
+	const __FlashStringHelper* section;
+};
+
+struct BatchResult
+{
+	// How the child process ended, as given by waitpid
+	int status;
+	bool done;
+	detail::Results results;
+	// Entries in the batch that finished
+	std::vector<bool> finished;
+	// Entry and section the child was in when it ended
+	int lastEntry;
+	const __FlashStringHelper* section;
+};
+
+[[noreturn]] void runChild(int fd, const Batch& batch)
+{
+	// So the output logged before a crash is not lost in the buffer
+	setvbuf(stdout, nullptr, _IONBF, 0);
+
+	// The parent's listeners would write their output (e.g: a trace file) from every child
+	detail::detachListeners();
+	ChildListener listener(fd, batch.first);
+	addListener(listener);
+	detail::gIsolatedBatch = {true, batch.first, batch.last};
+	IsolationAccess::runBatch();
+	listener.done();
+	flushlog();
+	fflush(nullptr);
+	// Not running static destructors or atexit handlers, since those belong to the parent
+	_exit(0);
+}
+
+bool runBatch(const Batch& batch, BatchResult& res)
+{
+	res.status = 0;
+	res.done = false;
+	res.results = {};
+	res.finished.assign(batch.last - batch.first, false);
+	res.lastEntry = batch.first;
+	res.section = nullptr;
+
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		CZMUT_LOG("ISOLATION: Can't create pipe (%s)\n", strerror(errno));
+		return false;
+	}
+
+	// Anything still buffered would be written by both processes
+	flushlog();
+	fflush(nullptr);
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		CZMUT_LOG("ISOLATION: Can't fork (%s)\n", strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		runChild(fds[1], batch);
+	}
+
+	close(fds[1]);
+	Message msg;
+	while (receiveMessage(fds[0], msg))
+	{
+		switch (msg.type)
+		{
+			case Message::Type::EntryStart:
+				res.lastEntry = msg.entry;
+				res.section = nullptr;
+				break;
+			case Message::Type::Section:
+				res.section = msg.section;
+				break;
+			case Message::Type::EntryEnd:
+				res.finished[msg.entry - batch.first] = true;
+				res.results = msg.results;
+				break;
+			case Message::Type::Done:
+				res.results = msg.results;
+				res.done = true;
+				break;
+		}
+	}
+	close(fds[0]);
+
+	while (waitpid(pid, &res.status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			CZMUT_LOG("ISOLATION: waitpid failed (%s)\n", strerror(errno));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void logCrash(const IsolationAccess::EntryInfo& entry, int status, const __FlashStringHelper* section, bool retry)
+{
+	if (getVerbosity() < Verbosity::Failures)
+	{
+		return;
+	}
+
+	logN(F("CRASHED: Test ["), entry.test->getName());
+	if (entry.typeName)
+	{
+		logN(F("<"), entry.typeName, F(">"));
+	}
+	logN(F("]. Section ["), section ? section : F("ROOT"), F("]. "));
+
+	if (WIFSIGNALED(status))
+	{
+		CZMUT_LOG("Signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+	}
+	else if (WIFEXITED(status))
+	{
+		CZMUT_LOG("Exit code %d", WEXITSTATUS(status));
+	}
+
+	if (retry)
+	{
+		logN(F(". Only when running after other tests"));
+	}
+	logN(F("\n"));
+}
+
+// "ran" is false if the test was already counted
+void countCrash(detail::Results& totals, bool ran)
+{
+	totals.testsRan += ran ? 1 : 0;
+	totals.testsFailed++;
+	totals.assertionsFailed++;
+}
+
+} // anonymous namespace
+
+bool runIsolated(const char* tags, const IsolationOptions& options)
+{
+	if (!IsolationAccess::filter(tags))
+	{
+		return false;
+	}
+
+	if (detail::TestCase::countEnabledTests() == 0)
+	{
+		logN(F("No tests enabled (check your tag expression)\n"));
+		logN(F("**** FAILED ****\n"));
+		return false;
+	}
+
+	detail::Results totals = {};
+	std::vector<IsolationAccess::EntryInfo> entries = IsolationAccess::getEnabledEntries(totals.testsSkipped);
+	int numEntries = static_cast<int>(entries.size());
+	int batchSize = options.batchSize > 0 ? options.batchSize : 1;
+
+	std::deque<Batch> pending;
+	for (int i = 0; i < numEntries; i += batchSize)
+	{
+		pending.push_back({i, i + batchSize < numEntries ? i + batchSize : numEntries, false, 0, nullptr});
+	}
+
+	int processes = 0;
+	int crashes = 0;
+	BatchResult res;
+	while (pending.size())
+	{
+		Batch batch = pending.front();
+		pending.pop_front();
+
+		processes++;
+		if (!runBatch(batch, res))
+		{
+			logN(F("**** FAILED ****\n"));
+			return false;
+		}
+
+		// Entries that finished are never run again, so their results can be counted right away
+		int finished = 0;
+		for (bool f : res.finished)
+		{
+			finished += f ? 1 : 0;
+		}
+		totals.testsRan += finished;
+		totals.testsFailed += res.results.testsFailed;
+		totals.assertions += res.results.assertions;
+		totals.assertionsFailed += res.results.assertionsFailed;
+
+		bool crashed = !res.done || !WIFEXITED(res.status) || WEXITSTATUS(res.status) != 0;
+		if (!crashed)
+		{
+			if (batch.retry)
+			{
+				// It crashed with other tests, but not on its own. Still a failure, since the crash needs looking into
+				logCrash(entries[batch.first], batch.status, batch.section, true);
+				crashes++;
+				countCrash(totals, false);
+			}
+			continue;
+		}
+
+		// The entry that was running when it crashed, or the first one that didn't finish
+		int culprit = -1;
+		for (int i = batch.first; i < batch.last && culprit == -1; i++)
+		{
+			culprit = res.finished[i - batch.first] ? -1 : i;
+		}
+		if (res.lastEntry >= batch.first && !res.finished[res.lastEntry - batch.first])
+		{
+			culprit = res.lastEntry;
+		}
+
+		if (culprit == -1)
+		{
+			// Everything finished, so it crashed on the way out (e.g: a static destructor)
+			logCrash(entries[res.lastEntry], res.status, nullptr, false);
+			crashes++;
+			countCrash(totals, false);
+			continue;
+		}
+
+		if (batch.last - batch.first == 1)
+		{
+			logCrash(entries[culprit], res.status, res.section, false);
+			crashes++;
+			countCrash(totals, true);
+			continue;
+		}
+
+		// The culprit runs again on its own, followed by the others that didn't finish
+		std::vector<Batch> again;
+		again.push_back({culprit, culprit + 1, true, res.status, res.section});
+		for (int i = batch.first; i < batch.last; i++)
+		{
+			if (res.finished[i - batch.first] || i == culprit)
+			{
+				continue;
+			}
+
+			int first = i;
+			while (i + 1 < batch.last && !res.finished[i + 1 - batch.first] && i + 1 != culprit)
+			{
+				i++;
+			}
+			for (int j = first; j <= i; j += batchSize)
+			{
+				again.push_back({j, j + batchSize <= i + 1 ? j + batchSize : i + 1, false, 0, nullptr});
+			}
+		}
+		pending.insert(pending.begin(), again.begin(), again.end());
+	}
+
+	if (getVerbosity() >= Verbosity::Normal)
+	{
+		CZMUT_LOG("ISOLATION: %d test entries in %d processes. %d crashed\n", numEntries, processes, crashes);
+	}
+
+	detail::mergeThreadCounters();
+	detail::gResults = totals;
+	detail::logFinalResults();
+	return totals.assertionsFailed == 0;
+}
+
+} // namespace cz::mut
+
+#endif
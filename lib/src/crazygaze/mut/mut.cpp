@@ -2,9 +2,16 @@
 #include <crazygaze/mut/mut.h>
 #undef CZMUT_SKIP_CPP17_CHECK
 
-#include <stdarg.h>
 #include <stdlib.h>
 
+#if CZMUT_THREADS
+	#include <mutex>
+#endif
+
+#if CZMUT_DESKTOP
+	#include <chrono>
+#endif
+
 // Setting this to 1 enabled some extra logging during the filter processing
 // Only useful for internal development.
 #define CZMUT_DEBUG_FILTER 0
@@ -22,6 +29,248 @@ namespace cz::mut::detail
 
 Results gResults;
 
+Verbosity gVerbosity = static_cast<Verbosity>(CZMUT_DEFAULT_VERBOSITY);
+
+// Use together with a `#if CZMUT_COMPILE_TIME_VERBOSITY >= level` guard, so the log call and its strings are not compiled
+// in if that level is disabled at compile time
+#define CZMUT_VERBOSITY_ENABLED(level) (static_cast<int>(::cz::mut::detail::gVerbosity) >= (level))
+
+#if CZMUT_BASELINES
+PassTimingHook gPassTimingHook;
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Static tests
+//////////////////////////////////////////////////////////////////////////
+
+#if CZMUT_STATIC_TEST_SECTION
+
+// Provided by the linker. Weak, so they are null if there are no static tests
+extern "C"
+{
+	extern const StaticTestInfo __start_czmut_static_tests[] __attribute__((weak));
+	extern const StaticTestInfo __stop_czmut_static_tests[] __attribute__((weak));
+}
+
+const StaticTestInfo* firstStaticTest()
+{
+	// Comparing pointers, since comparing the arrays themselves is deprecated
+	const StaticTestInfo* start = __start_czmut_static_tests;
+	const StaticTestInfo* stop = __stop_czmut_static_tests;
+	return start != stop ? start : nullptr;
+}
+
+const StaticTestInfo* nextStaticTest(const StaticTestInfo* test)
+{
+	const StaticTestInfo* stop = __stop_czmut_static_tests;
+	return test + 1 != stop ? test + 1 : nullptr;
+}
+
+#else
+
+namespace
+{
+	// Added during static initialization, before any tests run
+	StaticTestNode* gFirstStaticTest;
+}
+
+void registerStaticTest(StaticTestNode& node)
+{
+	node.next = gFirstStaticTest;
+	gFirstStaticTest = &node;
+}
+
+const StaticTestInfo* firstStaticTest()
+{
+	return gFirstStaticTest ? &gFirstStaticTest->info : nullptr;
+}
+
+const StaticTestInfo* nextStaticTest(const StaticTestInfo* test)
+{
+	const StaticTestNode* next = reinterpret_cast<const StaticTestNode*>(test)->next;
+	return next ? &next->info : nullptr;
+}
+
+#endif
+
+namespace
+{
+	// STATIC_TEST_CASEs selected by the tag expression of the last run, for the final report
+	int gSelectedStaticTests;
+}
+
+int countStaticTests()
+{
+	int count = 0;
+	for (const StaticTestInfo* test = firstStaticTest(); test; test = nextStaticTest(test))
+	{
+		count++;
+	}
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Listeners
+//////////////////////////////////////////////////////////////////////////
+
+#if CZMUT_LISTENERS
+
+struct ListenerAccess
+{
+	static Listener* first;
+
+	static Listener*& next(Listener& listener)
+	{
+		return listener.m_nextListener;
+	}
+};
+
+Listener* ListenerAccess::first;
+
+// Calls the specified event on all listeners. If there are no listeners, this is just a null check
+#define CZMUT_NOTIFY(Event, ...) \
+	do \
+	{ \
+		for (::cz::mut::Listener* listener = ::cz::mut::detail::ListenerAccess::first; listener; listener = ::cz::mut::detail::ListenerAccess::next(*listener)) \
+		{ \
+			listener->Event(__VA_ARGS__); \
+		} \
+	} while(false)
+
+#else
+	#define CZMUT_NOTIFY(Event, ...) do {} while(false)
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Thread safety
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+#if CZMUT_THREADS
+std::recursive_mutex& getLogMutex()
+{
+	static std::recursive_mutex mtx;
+	return mtx;
+}
+#endif
+
+//
+// Serializes failure reports and formatted logging, so the output from several threads doesn't get interleaved.
+// Does nothing if CZMUT_THREADS is 0.
+//
+class LogLock
+{
+public:
+#if CZMUT_THREADS
+	LogLock()
+	{
+		getLogMutex().lock();
+	}
+
+	~LogLock()
+	{
+		getLogMutex().unlock();
+	}
+#endif
+};
+
+#if CZMUT_THREADS
+//
+// Assertions counters for a single thread.
+// Only the owning thread writes to them, and there are no read-modify-write atomic operations involved, so counting
+// assertions costs the same as a non-atomic increment.
+// mergeThreadCounters() keeps track of how much it already merged from each thread, so it never needs to reset them.
+//
+struct ThreadCounters
+{
+	ThreadCounters();
+	~ThreadCounters();
+
+	std::atomic<int> assertions {0};
+
+	// Protected by gThreadCountersMutex
+	int merged = 0;
+	ThreadCounters* prev = nullptr;
+	ThreadCounters* next = nullptr;
+};
+
+std::mutex gThreadCountersMutex;
+ThreadCounters* gFirstThreadCounters;
+// Assertions from threads that finished before their counts were merged
+int gExitedThreadsAssertions;
+
+ThreadCounters::ThreadCounters()
+{
+	std::lock_guard<std::mutex> lock(gThreadCountersMutex);
+	next = gFirstThreadCounters;
+	if (next)
+	{
+		next->prev = this;
+	}
+	gFirstThreadCounters = this;
+}
+
+ThreadCounters::~ThreadCounters()
+{
+	std::lock_guard<std::mutex> lock(gThreadCountersMutex);
+	gExitedThreadsAssertions += assertions.load(std::memory_order_relaxed) - merged;
+	if (prev)
+	{
+		prev->next = next;
+	}
+	else
+	{
+		gFirstThreadCounters = next;
+	}
+
+	if (next)
+	{
+		next->prev = prev;
+	}
+}
+
+// A plain pointer, so the fast path doesn't need to go through the thread_local initialization checks
+thread_local ThreadCounters* gThreadCounters;
+
+ThreadCounters& createThreadCounters()
+{
+	static thread_local ThreadCounters counters;
+	gThreadCounters = &counters;
+	return counters;
+}
+#endif
+
+inline void countAssertion()
+{
+#if CZMUT_THREADS
+	ThreadCounters* counters = gThreadCounters;
+	std::atomic<int>& counter = counters ? counters->assertions : createThreadCounters().assertions;
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#else
+	gResults.assertions++;
+#endif
+}
+
+} // anonymous namespace
+
+void mergeThreadCounters()
+{
+#if CZMUT_THREADS
+	std::lock_guard<std::mutex> lock(gThreadCountersMutex);
+	for (ThreadCounters* counters = gFirstThreadCounters; counters; counters = counters->next)
+	{
+		int assertions = counters->assertions.load(std::memory_order_relaxed);
+		gResults.assertions += assertions - counters->merged;
+		counters->merged = assertions;
+	}
+
+	gResults.assertions += gExitedThreadsAssertions;
+	gExitedThreadsAssertions = 0;
+#endif
+}
+
 void debugbreak()
 {
 	#ifdef _WIN32
@@ -31,6 +280,8 @@ void debugbreak()
 		__asm__ __volatile__("break");
 	#elif CZMUT_RP2040
 		__builtin_trap();
+	#elif CZMUT_DESKTOP && defined(__GNUC__)
+		__builtin_trap();
 	#else
 		#warning Unknown or unsupported platform. Using an infinite loop as as debugbreak
 	#endif
@@ -73,19 +324,12 @@ const char* strrchr_P(const char* str, char c)
 
 	return (rtnval);
 }
-#elif defined(ARDUINO_ARCH_RP2040)
-
-	#if __MBED__
-	// Seems like this is missing if using the Mbed core ? (earlephilhower's core is fine)
-	#define vsnprintf_P(s, f, ...) vsnprintf((s), (f), __VA_ARGS__)
-	#endif
-	
 #endif
 
 #if CZMUT_DESKTOP
 void logStr(const char* str)
 {
-	printf(str);
+	fputs(str, stdout);
 }
 #elif defined(ARDUINO)
 void logStr(const char* str)
@@ -100,25 +344,6 @@ void logStr(const __FlashStringHelper* str)
 	#error Unknown or unsupported platform
 #endif
 
-void logFmt(const __FlashStringHelper* fmt, ...)
-{
-	va_list args;
-	va_start(args, fmt);
-#if CZMUT_DESKTOP
-	vprintf(fmt, args);
-#elif CZMUT_ARDUINO
-	constexpr int bufSize = 100;
-	char buf[bufSize];
-	vsnprintf_P(buf, bufSize, (const char*)fmt, args);
-	buf[bufSize-1] = 0;
-	CZMUT_SERIAL.print(buf);
-#else
-	#error Unknown or unsupported platform
-#endif
-
-	va_end(args);
-}
-
 void flushlog()
 {
 	#if CZMUT_DESKTOP
@@ -130,625 +355,3032 @@ void flushlog()
 	#endif
 }
 
-void log(const char* str)
-{
-	logStr(str);
-}
+//////////////////////////////////////////////////////////////////////////
+// Formatting
+//////////////////////////////////////////////////////////////////////////
 
-#if defined(ARDUINO)
-void log(const __FlashStringHelper* str)
+namespace
 {
-	logStr(str);
-}
-#endif
 
-#if CZMUT_DESKTOP // On Visual studio, we need to use _itoa
-	#define CZMUT_itoa _itoa
-#else
-	#define CZMUT_itoa itoa
-#endif
-
-void log(int val)
+// All the 2 digit decimal numbers, so integer conversion can output 2 digits per division
+static const char gDigitPairs[] PROGMEM =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char gHexDigits[] PROGMEM = "0123456789abcdef";
+
+inline char readChar_P(const char* str, unsigned index)
 {
-	constexpr int bufSize = 2 + 3 * sizeof(val);
-	char buf[bufSize];
-	CZMUT_itoa(val, buf, 10);
-	logStr(buf);
+	return *(FlashStringIterator(reinterpret_cast<const __FlashStringHelper*>(str)) + size_t(index));
 }
 
-void log(unsigned int val)
-{
-	constexpr int bufSize = 1 + 3 * sizeof(val);
-	char buf[bufSize];
-	CZMUT_itoa(val, buf, 10);
-	logStr(buf);
-}
+// Big enough for any 64 bits integer, with sign
+constexpr int NumberBufSize = 24;
 
-void log(long val)
-{
-	constexpr int bufSize = 2 + 3 * sizeof(val);
-	char buf[bufSize];
-	CZMUT_itoa(val, buf, 10);
-	logStr(buf);
-}
+// Big enough for a float with sign, 20 integer digits, '.' and the maximum precision we support
+constexpr int FloatBufSize = 40;
+constexpr int MaxFloatPrecision = 9;
 
-void log(unsigned long val)
+//
+// Writes the decimal representation of "val" backwards, ending at "end".
+// Returns a pointer to the first digit.
+//
+char* formatDecimal32(uint32_t val, char* end)
 {
-	constexpr int bufSize = 1 + 3 * sizeof(val);
-	char buf[bufSize];
-	CZMUT_itoa(val, buf, 10);
-	logStr(buf);
-}
+	while (val >= 100)
+	{
+		unsigned idx = unsigned(val % 100) * 2;
+		val /= 100;
+		*--end = readChar_P(gDigitPairs, idx + 1);
+		*--end = readChar_P(gDigitPairs, idx);
+	}
 
-void logFailedTest(const __FlashStringHelper* file, int line)
-{
-	TestCase* test = TestCase::getActive();
-	if (!test->hasFailed())
+	if (val >= 10)
 	{
-		gResults.testsFailed++;
-		test->setFailed();
+		unsigned idx = unsigned(val) * 2;
+		*--end = readChar_P(gDigitPairs, idx + 1);
+		*--end = readChar_P(gDigitPairs, idx);
 	}
-	logN(F("FAILED: Test ["), test->getName());
-	const __FlashStringHelper* typeName = test->getActiveTestType();
-	if (typeName)
+	else
 	{
-		logN(F("<"), typeName, F(">"));
+		*--end = char('0' + val);
 	}
-	logN(F("]. Section [" ), Section::getActive()->getName(), F("]. "));
-	logN(F("Location ["), file, F(":"), line, F("]:\n"));
+
+	return end;
 }
 
-void doCheck(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+char* formatDecimal(unsigned long long val, char* end)
 {
-	::cz::mut::detail::gResults.assertions++;
-	if (!result)
+	// Most values fit in 32 bits, and 32 bits divisions are a lot cheaper on small microcontrollers, so we only
+	// do 64 bits divisions to peel off chunks of 9 digits until the rest fits in 32 bits
+	while (val > 0xFFFFFFFFull)
 	{
-		cz::mut::detail::logAssertionFailure(F("CHECK"), file, line, expr_str);
+		uint32_t chunk = uint32_t(val % 1000000000ull);
+		val /= 1000000000ull;
+		char* chunkStart = formatDecimal32(chunk, end);
+		while (end - chunkStart < 9)
+		{
+			*--chunkStart = '0';
+		}
+		end = chunkStart;
 	}
+
+	return formatDecimal32(uint32_t(val), end);
 }
 
-void doRequire(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+char* formatHex(unsigned long long val, char* end, bool upperCase)
 {
-	::cz::mut::detail::gResults.assertions++;
-	if (!result)
+	do
 	{
-		cz::mut::detail::logAssertionFailure(F("REQUIRE"), file, line, expr_str);
-		logFinalResults();
-		cz::mut::detail::debugbreak();
-	}
-}
+		char ch = readChar_P(gHexDigits, unsigned(val & 0xF));
+		*--end = (upperCase && ch >= 'a') ? char(ch - 'a' + 'A') : ch;
+		val >>= 4;
+	} while (val);
 
-void logAssertionFailure(const __FlashStringHelper* assertionType, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
-{
-	gResults.assertionsFailed++;
-	logFailedTest(file, line);
-	logN(F("    "), assertionType, F(": "), expr_str, F("\n"));
-	flushlog();
+	return end;
 }
 
-void logRange(FlashStringIterator start, FlashStringIterator end)
+char* formatSigned(long long val, char* end)
 {
-	while(start!=end)
+	// Negating as unsigned, so it works for the minimum value
+	unsigned long long absVal = val < 0 ? (0 - static_cast<unsigned long long>(val)) : static_cast<unsigned long long>(val);
+	char* res = formatDecimal(absVal, end);
+	if (val < 0)
 	{
-		#if defined(ARDUINO)
-			CZMUT_SERIAL.print(*start);
-		#else
-			printf("%c", *start);
-		#endif
-		++start;
+		*--res = '-';
 	}
+	return res;
 }
 
-void logRange(const __FlashStringHelper* name, FlashStringIterator start, FlashStringIterator end)
-{
-	logN(name);
-	logN(F("("), size_t(start.c_str()), F("->"), size_t(end.c_str()), F("), Len="), end-start, F(":"));
-	logRange(start, end);
-	logN(F(":\n"));
-}
-
-
 //
-// Compares two tags in progmem space
-// Instead of being specified as NULL terminated strings, hey are specified as ranges, so they can be part of other strings
+// Formats a floating point number in fixed notation (or scientific notation if too big), without relying on printf.
+// Returns the size written to "buf", which needs to be at least FloatBufSize big.
 //
-bool compareStrings_P(FlashStringIterator aStart, FlashStringIterator aEnd, FlashStringIterator bStart, FlashStringIterator bEnd)
+int formatFloat(double val, int precision, char* buf)
 {
-	int todo = aEnd - aStart;
-	if (todo != (bEnd - bStart)) // if sizes don't match, well, then can't match
+	char* ptr = buf;
+
+	if (val != val)
 	{
-		return false;
+		memcpy(ptr, "nan", 3);
+		return 3;
 	}
 
-	while(todo--)
+	if (val < 0)
 	{
-		if (*aStart != *bStart)
+		*ptr++ = '-';
+		val = -val;
+	}
+
+	if (val - val != 0)
+	{
+		memcpy(ptr, "inf", 3);
+		return int(ptr - buf) + 3;
+	}
+
+	if (precision > MaxFloatPrecision)
+	{
+		precision = MaxFloatPrecision;
+	}
+
+	int exponent = 0;
+	if (val >= 1e18)
+	{
+		while (val >= 10)
 		{
-			return false;
+			val /= 10;
+			exponent++;
 		}
-		++aStart;
-		++bStart;
 	}
 
-	return true;
-}
+	double rounding = 0.5;
+	for (int i = 0; i < precision; i++)
+	{
+		rounding /= 10;
+	}
+	val += rounding;
 
-//////////////////////////////////////////////////////////////////////////
-// FlashStringIterator
-//////////////////////////////////////////////////////////////////////////
+	if (exponent && val >= 10)
+	{
+		val /= 10;
+		exponent++;
+	}
 
-char FlashStringIterator::operator*() const
-{
-#if defined(ARDUINO)
-	return pgm_read_byte(m_pos);
-#else
-	return *m_pos;
-#endif
+	unsigned long long intPart = static_cast<unsigned long long>(val);
+	double fraction = val - static_cast<double>(intPart);
+
+	char tmp[NumberBufSize];
+	char* digits = formatDecimal(intPart, tmp + NumberBufSize);
+	int numDigits = int(tmp + NumberBufSize - digits);
+	memcpy(ptr, digits, numDigits);
+	ptr += numDigits;
+
+	if (precision)
+	{
+		*ptr++ = '.';
+		while (precision--)
+		{
+			fraction *= 10;
+			int digit = int(fraction);
+			*ptr++ = char('0' + digit);
+			fraction -= digit;
+		}
+	}
+
+	if (exponent)
+	{
+		*ptr++ = 'e';
+		*ptr++ = '+';
+		char* expDigits = formatDecimal32(uint32_t(exponent), tmp + NumberBufSize);
+		numDigits = int(tmp + NumberBufSize - expDigits);
+		memcpy(ptr, expDigits, numDigits);
+		ptr += numDigits;
+	}
+
+	return int(ptr - buf);
 }
 
-size_t FlashStringIterator::len() const
+//
+// Small buffer that sends its contents to the log whenever it fills up.
+// This allows formatting output of any size without a big stack buffer and without truncation.
+// If a destination is specified, the contents go there instead of to the log, truncated to fit.
+//
+class LogBuffer
 {
-#if defined(ARDUINO)
-	return strlen_P(m_pos);
-#else
-	return strlen(m_pos);
-#endif
-}
+public:
+	LogBuffer() = default;
+
+	LogBuffer(char* dst, int dstSize)
+		: m_dst(dst)
+		, m_dstSize(dstSize)
+	{
+		if (m_dstSize > 0)
+		{
+			m_dst[0] = 0;
+		}
+	}
+
+	~LogBuffer()
+	{
+		flush();
+	}
+
+	void put(char ch)
+	{
+		if (m_len == BufSize)
+		{
+			flush();
+		}
+		m_buf[m_len++] = ch;
+	}
+
+	void write(const char* str, int len)
+	{
+		while (len--)
+		{
+			put(*str++);
+		}
+	}
+
+	void write(FlashStringIterator str, int len)
+	{
+		while (len--)
+		{
+			put(*str);
+			++str;
+		}
+	}
+
+	void fill(char ch, int count)
+	{
+		while (count-- > 0)
+		{
+			put(ch);
+		}
+	}
+
+	void flush()
+	{
+		if (m_len == 0)
+		{
+			return;
+		}
+
+		if (m_dst)
+		{
+			int todo = m_dstSize - 1 - m_dstLen;
+			todo = m_len < todo ? m_len : todo;
+			if (todo > 0)
+			{
+				memcpy(m_dst + m_dstLen, m_buf, todo);
+				m_dstLen += todo;
+				m_dst[m_dstLen] = 0;
+			}
+		}
+		else
+		{
+			m_buf[m_len] = 0;
+			logStr(m_buf);
+		}
+		m_len = 0;
+	}
+
+	// Characters written to the destination
+	int getDstLen() const
+	{
+		return m_dstLen;
+	}
+
+private:
+	static constexpr int BufSize = 32;
+	char m_buf[BufSize + 1];
+	int m_len = 0;
+	char* m_dst = nullptr;
+	int m_dstSize = 0;
+	int m_dstLen = 0;
+};
+
+struct FmtSpec
+{
+	bool leftAlign = false;
+	bool zeroPad = false;
+	bool plusSign = false;
+	bool spaceSign = false;
+	int width = 0;
+	int precision = -1;
+	char type = 0;
+};
+
+// Writes an already formatted number, applying sign, width and padding as required by the spec
+void writePadded(LogBuffer& out, const FmtSpec& spec, const char* str, int len)
+{
+	bool hasSign = len && (*str == '-' || *str == '+' || *str == ' ');
+	int padding = spec.width - len;
+	if (spec.leftAlign)
+	{
+		out.write(str, len);
+		out.fill(' ', padding);
+	}
+	else if (spec.zeroPad)
+	{
+		if (hasSign)
+		{
+			out.put(*str++);
+			len--;
+		}
+		out.fill('0', padding);
+		out.write(str, len);
+	}
+	else
+	{
+		out.fill(' ', padding);
+		out.write(str, len);
+	}
+}
+
+void formatArg(LogBuffer& out, const FmtSpec& spec, const FmtArg& arg)
+{
+	using Type = FmtArg::Type;
+	char buf[FloatBufSize];
+	char* end = buf + NumberBufSize;
+	char* start = end;
+
+	switch (spec.type)
+	{
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+		{
+			unsigned long long uval;
+			bool isNegative = false;
+			if (arg.type == Type::Int)
+			{
+				if (spec.type == 'd' || spec.type == 'i')
+				{
+					isNegative = arg.i < 0;
+					uval = isNegative ? (0 - static_cast<unsigned long long>(arg.i)) : static_cast<unsigned long long>(arg.i);
+				}
+				else
+				{
+					// %u and %x show the bits of the original type, the same way printf does it. E.g: -1 as an int is
+					// ffffffff, not ffffffffffffffff. Types smaller than int are promoted to int, like with printf
+					unsigned int size = arg.size > sizeof(int) ? arg.size : sizeof(int);
+					uval = static_cast<unsigned long long>(arg.i);
+					if (size < sizeof(uval))
+					{
+						uval &= (1ULL << (size * 8)) - 1;
+					}
+				}
+			}
+			else if (arg.type == Type::UInt)
+			{
+				uval = arg.u;
+			}
+			else if (arg.type == Type::Char)
+			{
+				uval = static_cast<unsigned char>(arg.c);
+			}
+			else
+			{
+				break;
+			}
+
+			if (spec.type == 'x' || spec.type == 'X')
+			{
+				start = formatHex(uval, end, spec.type == 'X');
+			}
+			else
+			{
+				start = formatDecimal(uval, end);
+				if (isNegative)
+					*--start = '-';
+				else if (spec.plusSign)
+					*--start = '+';
+				else if (spec.spaceSign)
+					*--start = ' ';
+			}
+			writePadded(out, spec, start, int(end - start));
+			return;
+		}
+
+		case 'c':
+		{
+			buf[0] = arg.type == Type::Char ? arg.c : char(arg.u);
+			writePadded(out, spec, buf, 1);
+			return;
+		}
+
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		{
+			if (arg.type != Type::Float)
+			{
+				break;
+			}
+			start = buf;
+			if (arg.f >= 0 && (spec.plusSign || spec.spaceSign))
+			{
+				*start++ = spec.plusSign ? '+' : ' ';
+			}
+			int len = formatFloat(arg.f, spec.precision < 0 ? 6 : spec.precision, start);
+			writePadded(out, spec, buf, int(start - buf) + len);
+			return;
+		}
+
+		case 's':
+		case 'S':
+		{
+			if (arg.type == Type::Str)
+			{
+				const char* str = arg.s ? arg.s : "(null)";
+				int len = int(strlen(str));
+				if (spec.precision >= 0 && spec.precision < len)
+					len = spec.precision;
+				if (!spec.leftAlign)
+					out.fill(' ', spec.width - len);
+				out.write(str, len);
+				if (spec.leftAlign)
+					out.fill(' ', spec.width - len);
+				return;
+			}
+		#if defined(ARDUINO)
+			else if (arg.type == Type::FlashStr)
+			{
+				FlashStringIterator str(arg.fs);
+				int len = int(str.len());
+				if (spec.precision >= 0 && spec.precision < len)
+					len = spec.precision;
+				if (!spec.leftAlign)
+					out.fill(' ', spec.width - len);
+				out.write(str, len);
+				if (spec.leftAlign)
+					out.fill(' ', spec.width - len);
+				return;
+			}
+		#endif
+			break;
+		}
+
+		case 'p':
+		{
+			if (arg.type != Type::Ptr && arg.type != Type::Str && arg.type != Type::FlashStr)
+			{
+				break;
+			}
+			start = formatHex(reinterpret_cast<uintptr_t>(arg.p), end, false);
+			*--start = 'x';
+			*--start = '0';
+			writePadded(out, spec, start, int(end - start));
+			return;
+		}
+	}
+
+	// Only reachable when logFmtArgs is used directly with a format string that doesn't match the arguments. CZMUT_LOG
+	// checks this at compile time.
+	out.write("<?>", 3);
+}
+
+void formatFmtArgs(LogBuffer& out, const __FlashStringHelper* fmt, const FmtArg* args, int count)
+{
+	FlashStringIterator it(fmt);
+	int argIndex = 0;
+
+	while (char ch = *it)
+	{
+		++it;
+		if (ch != '%')
+		{
+			out.put(ch);
+			continue;
+		}
+
+		if (*it == '%')
+		{
+			out.put('%');
+			++it;
+			continue;
+		}
+
+		FmtSpec spec;
+		for (;; ++it)
+		{
+			char flag = *it;
+			if (flag == '-')
+				spec.leftAlign = true;
+			else if (flag == '0')
+				spec.zeroPad = true;
+			else if (flag == '+')
+				spec.plusSign = true;
+			else if (flag == ' ')
+				spec.spaceSign = true;
+			else if (flag != '#')
+				break;
+		}
+
+		while (*it >= '0' && *it <= '9')
+		{
+			spec.width = spec.width * 10 + (*it - '0');
+			++it;
+		}
+
+		if (*it == '.')
+		{
+			++it;
+			spec.precision = 0;
+			while (*it >= '0' && *it <= '9')
+			{
+				spec.precision = spec.precision * 10 + (*it - '0');
+				++it;
+			}
+		}
+
+		// Length modifiers are not needed, since we know the type of each argument
+		while (*it == 'h' || *it == 'l' || *it == 'z' || *it == 'j' || *it == 't' || *it == 'L')
+		{
+			++it;
+		}
+
+		spec.type = *it;
+		if (spec.type == 0)
+		{
+			break;
+		}
+		++it;
+
+		if (argIndex < count)
+		{
+			formatArg(out, spec, args[argIndex++]);
+		}
+		else
+		{
+			out.write("<?>", 3);
+		}
+	}
+}
+
+} // anonymous namespace
+
+void logFmtArgs(const __FlashStringHelper* fmt, const FmtArg* args, int count)
+{
+	LogLock lock;
+	LogBuffer out;
+	formatFmtArgs(out, fmt, args, count);
+}
+
+int formatFmtArgs(char* dst, int dstSize, const __FlashStringHelper* fmt, const FmtArg* args, int count)
+{
+	LogBuffer out(dst, dstSize);
+	formatFmtArgs(out, fmt, args, count);
+	out.flush();
+	return out.getDstLen();
+}
+
+void log(const char* str)
+{
+	logStr(str);
+}
+
+#if defined(ARDUINO)
+void log(const __FlashStringHelper* str)
+{
+	logStr(str);
+}
+#endif
+
+void log(char val)
+{
+	char buf[2] = {val, 0};
+	logStr(buf);
+}
+
+namespace
+{
+	// int and long only need 64 bits divisions where long is 64 bits, so on 8/32 bits microcontrollers these don't pull
+	// in the 64 bits division code
+	void logUnsigned32(uint32_t val)
+	{
+		char buf[NumberBufSize];
+		buf[NumberBufSize - 1] = 0;
+		logStr(formatDecimal32(val, buf + NumberBufSize - 1));
+	}
+
+	void logSigned32(int32_t val)
+	{
+		char buf[NumberBufSize];
+		buf[NumberBufSize - 1] = 0;
+		// Negating as unsigned, so it works for the minimum value
+		char* start = formatDecimal32(val < 0 ? (0 - static_cast<uint32_t>(val)) : static_cast<uint32_t>(val), buf + NumberBufSize - 1);
+		if (val < 0)
+		{
+			*--start = '-';
+		}
+		logStr(start);
+	}
+}
+
+void log(int val)
+{
+	if constexpr (sizeof(int) <= sizeof(int32_t))
+		logSigned32(val);
+	else
+		log(static_cast<long long>(val));
+}
+
+void log(unsigned int val)
+{
+	if constexpr (sizeof(unsigned int) <= sizeof(uint32_t))
+		logUnsigned32(val);
+	else
+		log(static_cast<unsigned long long>(val));
+}
+
+void log(long val)
+{
+	if constexpr (sizeof(long) <= sizeof(int32_t))
+		logSigned32(val);
+	else
+		log(static_cast<long long>(val));
+}
+
+void log(unsigned long val)
+{
+	if constexpr (sizeof(unsigned long) <= sizeof(uint32_t))
+		logUnsigned32(val);
+	else
+		log(static_cast<unsigned long long>(val));
+}
+
+void log(long long val)
+{
+	char buf[NumberBufSize];
+	buf[NumberBufSize - 1] = 0;
+	logStr(formatSigned(val, buf + NumberBufSize - 1));
+}
+
+void log(unsigned long long val)
+{
+	char buf[NumberBufSize];
+	buf[NumberBufSize - 1] = 0;
+	logStr(formatDecimal(val, buf + NumberBufSize - 1));
+}
+
+void log(double val)
+{
+	char buf[FloatBufSize + 1];
+	buf[formatFloat(val, 6, buf)] = 0;
+	logStr(buf);
+}
+
+void log(const void* val)
+{
+	char buf[NumberBufSize];
+	buf[NumberBufSize - 1] = 0;
+	char* start = formatHex(reinterpret_cast<uintptr_t>(val), buf + NumberBufSize - 1, false);
+	*--start = 'x';
+	*--start = '0';
+	logStr(start);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// INFO / CAPTURE
+//////////////////////////////////////////////////////////////////////////
+
+#if CZMUT_INFO_CAPACITY
+
+namespace
+{
+	struct InfoEntry
+	{
+		// Format string, or the captured expression
+		const __FlashStringHelper* fmt;
+		// Position of the first argument in InfoState::args
+		unsigned int argsPos;
+		unsigned char numArgs;
+		bool isCapture;
+	};
+
+	//
+	// Ring buffers of entries and arguments.
+	// Positions only ever grow (until popped), and are used modulo the capacity, so if a buffer is full, the newest entries
+	// overwrite the oldest ones.
+	//
+	struct InfoState
+	{
+		InfoEntry entries[CZMUT_INFO_CAPACITY];
+		FmtArg args[CZMUT_INFO_ARGS];
+		unsigned int entriesPos;
+		unsigned int argsPos;
+	};
+
+#if CZMUT_THREADS
+	thread_local
+#endif
+	InfoState gInfo;
+}
+
+unsigned int infoPush(const __FlashStringHelper* fmt, bool isCapture, const FmtArg* args, int count, unsigned int& argsPos)
+{
+	InfoState& info = gInfo;
+	unsigned int pos = info.entriesPos++;
+	InfoEntry& entry = info.entries[pos % CZMUT_INFO_CAPACITY];
+	entry.fmt = fmt;
+	entry.argsPos = info.argsPos;
+	entry.numArgs = static_cast<unsigned char>(count);
+	entry.isCapture = isCapture;
+
+	argsPos = info.argsPos;
+	for (int i = 0; i < count; i++)
+	{
+		info.args[info.argsPos++ % CZMUT_INFO_ARGS] = args[i];
+	}
+
+	return pos;
+}
+
+void infoPop(unsigned int pos, unsigned int argsPos)
+{
+	gInfo.entriesPos = pos;
+	gInfo.argsPos = argsPos;
+}
+
+void logInfo()
+{
+	const InfoState& info = gInfo;
+	unsigned int first = 0;
+	if (info.entriesPos > CZMUT_INFO_CAPACITY)
+	{
+		first = info.entriesPos - CZMUT_INFO_CAPACITY;
+		logN(F("    ("), first, F(" older INFO/CAPTURE dropped)\n"));
+	}
+
+	for (unsigned int pos = first; pos < info.entriesPos; pos++)
+	{
+		const InfoEntry& entry = info.entries[pos % CZMUT_INFO_CAPACITY];
+		// If the arguments were overwritten, we can still log what the entry is about
+		bool hasArgs = (info.argsPos - entry.argsPos) <= CZMUT_INFO_ARGS;
+
+		if (entry.isCapture)
+		{
+			logN(F("    CAPTURE: "), entry.fmt, F(" := "));
+			for (int i = 0; hasArgs && i < entry.numArgs; i++)
+			{
+				const FmtArg& arg = info.args[(entry.argsPos + i) % CZMUT_INFO_ARGS];
+				const __FlashStringHelper* spec;
+				switch (arg.type)
+				{
+					case FmtArg::Type::Int: spec = F("%d"); break;
+					case FmtArg::Type::UInt: spec = F("%u"); break;
+					case FmtArg::Type::Float: spec = F("%f"); break;
+					case FmtArg::Type::Char: spec = F("'%c'"); break;
+					case FmtArg::Type::Str: spec = F("\"%s\""); break;
+					case FmtArg::Type::FlashStr: spec = F("\"%S\""); break;
+					default: spec = F("%p"); break;
+				}
+				if (i)
+				{
+					logN(F(", "));
+				}
+				logFmtArgs(spec, &arg, 1);
+			}
+		}
+		else
+		{
+			logN(F("    INFO: "));
+			if (hasArgs)
+			{
+				// The arguments can wrap around the end of the ring buffer, so copy them to a contiguous array
+				FmtArg args[CZMUT_INFO_ARGS];
+				for (int i = 0; i < entry.numArgs; i++)
+				{
+					args[i] = info.args[(entry.argsPos + i) % CZMUT_INFO_ARGS];
+				}
+				logFmtArgs(entry.fmt, args, entry.numArgs);
+			}
+			else
+			{
+				logN(entry.fmt);
+			}
+		}
+
+		if (!hasArgs)
+		{
+			logN(F(" (values dropped)"));
+		}
+		logN(F("\n"));
+	}
+}
+
+#endif
+
+void logFailedTest(const __FlashStringHelper* file, int line)
+{
+	// Can be null if the failure doesn't come from a test (e.g: a TestArena allocation outside of a test)
+	TestCase* test = TestCase::getActive();
+	if (test && !test->hasFailed())
+	{
+		gResults.testsFailed++;
+		test->setFailed();
+	}
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_FAILURES
+	if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_FAILURES))
+	{
+		if (test)
+		{
+			logN(F("FAILED: Test ["), test->getName());
+			const __FlashStringHelper* typeName = test->getActiveTestType();
+			if (typeName)
+			{
+				logN(F("<"), typeName, F(">"));
+			}
+			// Async tests don't have sections
+			Section* section = Section::getActive();
+			logN(F("]. Section [" ), section ? section->getName() : F("ROOT"), F("]"));
+		}
+		else
+		{
+			logN(F("FAILED: Outside of a test"));
+		}
+
+		// Not all failures have a location
+		if (file)
+		{
+			logN(F(". Location ["), file, F(":"), line, F("]"));
+		}
+		logN(F(":\n"));
+	#if CZMUT_INFO_CAPACITY
+		logInfo();
+	#endif
+	}
+#endif
+}
+
+void doCheck(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+{
+	countAssertion();
+	CZMUT_NOTIFY(onAssertion, file, line, expr_str, result);
+	if (!result)
+	{
+		cz::mut::detail::logAssertionFailure(F("CHECK"), file, line, expr_str);
+	}
+}
+
+void doRequire(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+{
+	countAssertion();
+	CZMUT_NOTIFY(onAssertion, file, line, expr_str, result);
+	if (!result)
+	{
+		LogLock lock;
+		cz::mut::detail::logAssertionFailure(F("REQUIRE"), file, line, expr_str);
+#if CZMUT_ISOLATION
+		// In a child process of runIsolated, the parent reports the crash and logs the final results
+		if (!gIsolatedBatch.active)
+#endif
+		{
+			logFinalResults();
+		}
+		cz::mut::detail::debugbreak();
+	}
+}
+
+void logAssertionFailure(const __FlashStringHelper* assertionType, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+{
+	// Holding the lock for the entire report, so it's not interleaved with failures from other threads.
+	// This also protects the failure counters and the test's failed flag.
+	LogLock lock;
+	gResults.assertionsFailed++;
+	logFailedTest(file, line);
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_FAILURES
+	if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_FAILURES))
+	{
+		logN(F("    "), assertionType, F(": "), expr_str, F("\n"));
+	}
+#endif
+	flushlog();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TestArena
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	struct TestArenaState
+	{
+		unsigned char* buffer;
+		size_t capacity;
+		size_t used;
+		size_t peak;
+		size_t liveAllocations;
+		size_t liveBytes;
+	};
+
+	TestArenaState gTestArena;
+}
+
+void* testArenaAllocate(unsigned char* buffer, size_t capacity, size_t size, size_t alignment)
+{
+	gTestArena.buffer = buffer;
+	gTestArena.capacity = capacity;
+
+	uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+	uintptr_t alignMask = static_cast<uintptr_t>(alignment) - 1;
+	size_t offset = static_cast<size_t>(((base + gTestArena.used + alignMask) & ~alignMask) - base);
+	if (offset > capacity || size > capacity - offset)
+	{
+		// The caller's location is not known, but the test and section are
+		logAssertionFailure(F("TestArena"), nullptr, 0, F("Out of memory. Increase CZMUT_TEST_ARENA_SIZE"));
+		return nullptr;
+	}
+
+	gTestArena.used = offset + size;
+	if (gTestArena.used > gTestArena.peak)
+	{
+		gTestArena.peak = gTestArena.used;
+	}
+	gTestArena.liveAllocations++;
+	gTestArena.liveBytes += size;
+	return buffer + offset;
+}
+
+void testArenaBeginTest()
+{
+	gTestArena.peak = 0;
+}
+
+void testArenaEndPass()
+{
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_FAILURES
+	if (gTestArena.liveAllocations && CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_FAILURES))
+	{
+		TestCase* test = TestCase::getActive();
+		logN(F("ARENA LEAK: Test ["), test->getName());
+		const __FlashStringHelper* typeName = test->getActiveTestType();
+		if (typeName)
+		{
+			logN(F("<"), typeName, F(">"));
+		}
+		logN(F("]. "), gTestArena.liveAllocations, F(" allocations ("), gTestArena.liveBytes, F(" bytes) not freed by the end of the pass\n"));
+	}
+#endif
+
+	gTestArena.used = 0;
+	gTestArena.liveAllocations = 0;
+	gTestArena.liveBytes = 0;
+}
+
+void testArenaEndTest()
+{
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_VERBOSE
+	if (gTestArena.peak && CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_VERBOSE))
+	{
+		logN(F("    TestArena peak usage: "), gTestArena.peak, F(" bytes\n"));
+	}
+#endif
+}
+
+void logRange(FlashStringIterator start, FlashStringIterator end)
+{
+	LogBuffer out;
+	out.write(start, end - start);
+}
+
+void logRange(const __FlashStringHelper* name, FlashStringIterator start, FlashStringIterator end)
+{
+	logN(name);
+	logN(F("("), size_t(start.c_str()), F("->"), size_t(end.c_str()), F("), Len="), end-start, F(":"));
+	logRange(start, end);
+	logN(F(":\n"));
+}
+
+
+//
+// Compares two tags in progmem space
+// Instead of being specified as NULL terminated strings, hey are specified as ranges, so they can be part of other strings
+//
+bool compareStrings_P(FlashStringIterator aStart, FlashStringIterator aEnd, FlashStringIterator bStart, FlashStringIterator bEnd)
+{
+	int todo = aEnd - aStart;
+	if (todo != (bEnd - bStart)) // if sizes don't match, well, then can't match
+	{
+		return false;
+	}
+
+	while(todo--)
+	{
+		if (*aStart != *bStart)
+		{
+			return false;
+		}
+		++aStart;
+		++bStart;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FlashStringIterator
+//////////////////////////////////////////////////////////////////////////
+
+char FlashStringIterator::operator*() const
+{
+#if CZMUT_AVR
+	return m_ram ? *m_pos : pgm_read_byte(m_pos);
+#elif defined(ARDUINO)
+	return pgm_read_byte(m_pos);
+#else
+	return *m_pos;
+#endif
+}
+
+size_t FlashStringIterator::len() const
+{
+#if CZMUT_AVR
+	return m_ram ? strlen(m_pos) : strlen_P(m_pos);
+#elif defined(ARDUINO)
+	return strlen_P(m_pos);
+#else
+	return strlen(m_pos);
+#endif
+}
 
 FlashStringIterator FlashStringIterator::findChar(char ch, size_t pos) const
 {
-#if defined(ARDUINO)
-	return FlashStringIterator(strchr_P(m_pos + pos, ch));
+	FlashStringIterator it(*this);
+#if CZMUT_AVR
+	it.m_pos = m_ram ? strchr(m_pos + pos, ch) : strchr_P(m_pos + pos, ch);
+#elif defined(ARDUINO)
+	it.m_pos = strchr_P(m_pos + pos, ch);
+#else
+	it.m_pos = strchr(m_pos + pos, ch);
+#endif
+	return it;
+}
+
+FlashStringIterator FlashStringIterator::findLastChar(char ch) const
+{
+	FlashStringIterator it(*this);
+#if CZMUT_AVR
+	it.m_pos = m_ram ? strrchr(m_pos, ch) : strrchr_P(m_pos, ch);
+#elif defined(ARDUINO)
+	it.m_pos = strrchr_P(m_pos, ch);
+#else
+	it.m_pos = strrchr(m_pos, ch);
+#endif
+	return it;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Section
+//////////////////////////////////////////////////////////////////////////
+CZMUT_ATOMIC(Section*) Section::ms_active;
+Section* Section::ms_firstStarted;
+Section* Section::ms_lastExecuted;
+const __FlashStringHelper* Section::ms_filterPath;
+bool Section::ms_filterPathMatched;
+
+Section::Section(const __FlashStringHelper* name)
+	: m_name(name)
+	, m_state(State::Ready)
+	, m_childExecuted(false)
+	, m_hasActiveChild(false)
+	, m_started(false)
+{
+}
+
+Section::~Section()
+{
+	ms_active = m_parent;
+}
+
+cz::mut::detail::Section* Section::getActive()
+{
+	return ms_active;
+}
+
+const __FlashStringHelper* Section::getName() const
+{
+	return m_name;
+}
+
+void Section::setFilterPath(const __FlashStringHelper* path)
+{
+	ms_filterPath = path;
+	ms_filterPathMatched = false;
+}
+
+bool Section::hasMatchedFilterPath()
+{
+	return ms_filterPathMatched;
+}
+
+bool Section::matchesFilterPath()
+{
+	// The root section is not part of the path
+	int depth = 0;
+	for (const Section* s = m_parent; s; s = s->m_parent)
+	{
+		depth++;
+	}
+
+	// Find the path element for our depth
+	FlashStringIterator elementStart(ms_filterPath);
+	FlashStringIterator elementEnd = elementStart.findChar('/');
+	while (--depth)
+	{
+		if (!elementEnd)
+		{
+			// The path is shorter than our depth, so we are a child of the last section in the path
+			return true;
+		}
+		elementStart = elementEnd + 1;
+		elementEnd = elementStart.findChar('/');
+	}
+
+	bool isLastElement = !elementEnd;
+	if (isLastElement)
+	{
+		elementEnd = elementStart + elementStart.len();
+	}
+
+	FlashStringIterator name(m_name);
+	if (!compareStrings_P(elementStart, elementEnd, name, name + name.len()))
+	{
+		return false;
+	}
+
+	if (isLastElement)
+	{
+		ms_filterPathMatched = true;
+	}
+
+	return true;
+}
+
+bool Section::tryExecute()
+{
+	if ((m_parent && m_parent->m_childExecuted) || (m_state == State::Finished))
+	{
+		return false;
+	}
+
+	if (ms_filterPath && m_parent && !matchesFilterPath())
+	{
+		// Not in the path, so it's marked as finished without ever being executed
+		m_state = State::Finished;
+		return false;
+	}
+
+	m_state = State::Running;
+	m_childExecuted = false;
+	m_hasActiveChild = false;
+	if (m_parent)
+	{
+		m_parent->m_childExecuted = true;
+	}
+	ms_lastExecuted = this;
+	CZMUT_NOTIFY(onSectionEnter, *this);
+	return true;
+}
+
+void Section::reset()
+{
+	m_state = State::Ready;
+	m_childExecuted = false;
+	m_hasActiveChild = false;
+}
+
+void Section::resetAll()
+{
+	for (Section* section = ms_firstStarted; section; section = section->m_nextStarted)
+	{
+		section->reset();
+	}
+	ms_active = nullptr;
+	ms_lastExecuted = nullptr;
+}
+
+void Section::start()
+{
+	if (!m_started)
+	{
+		m_started = true;
+		m_nextStarted = ms_firstStarted;
+		ms_firstStarted = this;
+	}
+
+	if (ms_active == nullptr)
+	{
+		ms_active = this;
+		m_parent = nullptr;
+	}
+	else
+	{
+		m_parent = ms_active;
+		ms_active = this;
+		m_parent->onChildStart();
+	}
+}
+
+void Section::end()
+{
+	if (m_state == State::Ready)
+	{
+		// If the state is "Ready", it means we are skipping this section. As-in, tryExecute failed
+	}
+	else if (m_state == State::Running)
+	{
+		CZMUT_NOTIFY(onSectionExit, *this);
+		if (m_hasActiveChild)
+		{
+			m_state = State::Ready;
+		}
+		else
+		{
+			m_state = State::Finished;
+		}
+	}
+	else if (m_state == State::Finished)
+	{
+		//
+	}
+	else
+	{
+		CZMUT_ASSERT(false);
+	}
+
+	if (m_parent)
+	{
+		m_parent->onChildEnd(m_state);
+		ms_active = m_parent;
+	}
+	else
+	{
+		ms_active = nullptr;
+	}
+}
+
+void Section::onChildStart()
+{
+}
+
+void Section::onChildEnd(State childState)
+{
+	if (childState == State::Ready)
+	{
+		m_hasActiveChild = true;
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// TestCase
+//////////////////////////////////////////////////////////////////////////
+
+Registry* TestCase::ms_registry = &registries::global;
+CZMUT_ATOMIC(TestCase*) TestCase::ms_active;
+CZMUT_ATOMIC(TestCase::Entry*) TestCase::ms_activeEntry;
+
+TestCase::TestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags)
+	: m_name(name)
+	, m_tags(tags)
+	, m_enabled(false)
+	, m_failed(false)
+{
+	if (registry.m_first == nullptr)
+	{
+		registry.m_last = registry.m_first = this;
+	}
+	else
+	{
+		registry.m_last->m_next = this;
+		registry.m_last = this;
+	}
+	registry.m_count++;
+}
+
+TestCase::~TestCase()
+{
+}
+namespace
+{
+	enum class NamePatternKind
+	{
+		None,
+		Exact,
+		Wildcard,
+		Id
+	};
+
+	NamePatternKind getNamePatternKind(detail::FlashStringIterator start, detail::FlashStringIterator end)
+	{
+		if (start == end)
+		{
+			return NamePatternKind::None;
+		}
+
+		if (*start == '#' && (end - start) > 1)
+		{
+			detail::FlashStringIterator it = start + 1;
+			while (it < end && *it >= '0' && *it <= '9')
+			{
+				++it;
+			}
+
+			if (it == end)
+			{
+				return NamePatternKind::Id;
+			}
+		}
+
+		return start.findChar('*') && start.findChar('*') < end ? NamePatternKind::Wildcard : NamePatternKind::Exact;
+	}
+
+	int parseId(detail::FlashStringIterator start, detail::FlashStringIterator end)
+	{
+		int id = 0;
+		for (detail::FlashStringIterator it = start + 1; it < end; ++it)
+		{
+			id = id * 10 + (*it - '0');
+		}
+		return id;
+	}
+
+	/**
+	 * Matches a string against a pattern where '*' matches any sequence of characters (including none)
+	 */
+	bool matchesWildcard(detail::FlashStringIterator pattern, detail::FlashStringIterator patternEnd, detail::FlashStringIterator str, detail::FlashStringIterator strEnd)
+	{
+		// Where to resume if a mismatch happens after a '*'
+		detail::FlashStringIterator starPattern(nullptr);
+		detail::FlashStringIterator starStr(nullptr);
+
+		while (str < strEnd)
+		{
+			if (pattern < patternEnd && *pattern == '*')
+			{
+				starPattern = ++pattern;
+				starStr = str;
+			}
+			else if (pattern < patternEnd && *pattern == *str)
+			{
+				++pattern;
+				++str;
+			}
+			else if (starPattern)
+			{
+				pattern = starPattern;
+				str = ++starStr;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		while (pattern < patternEnd && *pattern == '*')
+		{
+			++pattern;
+		}
+
+		return pattern == patternEnd;
+	}
+
+	bool matchesNamePattern(const __FlashStringHelper* testName, int testId, NamePatternKind kind, detail::FlashStringIterator patternStart, detail::FlashStringIterator patternEnd)
+	{
+		detail::FlashStringIterator name(testName);
+		switch (kind)
+		{
+			case NamePatternKind::None:
+				return true;
+			case NamePatternKind::Exact:
+				return detail::compareStrings_P(patternStart, patternEnd, name, name + name.len());
+			case NamePatternKind::Wildcard:
+				return matchesWildcard(patternStart, patternEnd, name, name + name.len());
+			case NamePatternKind::Id:
+				return parseId(patternStart, patternEnd) == testId;
+		}
+		return false;
+	}
+
+	/**
+	 * Checks if a range is a (possibly empty) list of tags. E.g: "[foo][bar]"
+	 */
+	bool isValidTagList(detail::FlashStringIterator tagStart, detail::FlashStringIterator tagsEnd)
+	{
+		while (tagStart < tagsEnd)
+		{
+			detail::FlashStringIterator tagEnd = tagStart.findChar('[', 1);
+			if (!tagEnd || tagEnd > tagsEnd)
+			{
+				tagEnd = tagsEnd;
+			}
+
+			if ((tagEnd - tagStart) < 2 || *tagStart != '[' || *(tagEnd-1) != ']')
+			{
+				return false;
+			}
+
+			tagStart = tagEnd;
+		}
+
+		return true;
+	}
+
+#if CZMUT_NAME_INDEX
+	// FNV-1a
+	uint32_t hashName(detail::FlashStringIterator start, detail::FlashStringIterator end)
+	{
+		uint32_t hash = 2166136261u;
+		while (start < end)
+		{
+			hash ^= static_cast<unsigned char>(*start);
+			hash *= 16777619u;
+			++start;
+		}
+		return hash;
+	}
+
+	struct NameIndexEntry
+	{
+		uint32_t hash;
+		int id;
+	};
+
+	struct NameIndex
+	{
+		// Sorted by hash
+		NameIndexEntry* byHash = nullptr;
+		// Indexed by ID-1
+		TestCase** byId = nullptr;
+		int count = 0;
+		// Registry the index was built for
+		const Registry* registry = nullptr;
+	} gNameIndex;
+
+	int compareNameIndexEntries(const void* a, const void* b)
+	{
+		uint32_t ha = static_cast<const NameIndexEntry*>(a)->hash;
+		uint32_t hb = static_cast<const NameIndexEntry*>(b)->hash;
+		return ha < hb ? -1 : (ha > hb ? 1 : 0);
+	}
+#endif
+}
+
+bool TestCase::updateNameIndex()
+{
+#if CZMUT_NAME_INDEX
+	// Tests are never unregistered, so if the count didn't change, the index is up to date
+	int count = ms_registry->getCount();
+	if (gNameIndex.registry == ms_registry && gNameIndex.count == count)
+	{
+		return gNameIndex.count != 0;
+	}
+
+	free(gNameIndex.byHash);
+	free(gNameIndex.byId);
+	gNameIndex.byHash = static_cast<NameIndexEntry*>(malloc(sizeof(NameIndexEntry) * count));
+	gNameIndex.byId = static_cast<TestCase**>(malloc(sizeof(TestCase*) * count));
+	gNameIndex.count = 0;
+	gNameIndex.registry = ms_registry;
+	if (!gNameIndex.byHash || !gNameIndex.byId)
+	{
+		free(gNameIndex.byHash);
+		free(gNameIndex.byId);
+		gNameIndex.byHash = nullptr;
+		gNameIndex.byId = nullptr;
+		return false;
+	}
+
+	int index = 0;
+	for (TestCase* test = getFirst(); test; test = test->m_next, index++)
+	{
+		detail::FlashStringIterator name(test->m_name);
+		gNameIndex.byHash[index].hash = hashName(name, name + name.len());
+		gNameIndex.byHash[index].id = index + 1;
+		gNameIndex.byId[index] = test;
+	}
+	qsort(gNameIndex.byHash, index, sizeof(NameIndexEntry), compareNameIndexEntries);
+	gNameIndex.count = index;
+	return true;
+#else
+	return false;
+#endif
+}
+
+template<typename Func>
+void TestCase::forEachNamed(detail::FlashStringIterator nameStart, detail::FlashStringIterator nameEnd, Func&& func)
+{
+#if CZMUT_NAME_INDEX
+	if (updateNameIndex())
+	{
+		uint32_t hash = hashName(nameStart, nameEnd);
+
+		// Find the first entry with the hash
+		int lo = 0;
+		int hi = gNameIndex.count;
+		while (lo < hi)
+		{
+			int mid = lo + (hi - lo) / 2;
+			if (gNameIndex.byHash[mid].hash < hash)
+			{
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+
+		// Different names can have the same hash, so we still need to compare the names
+		for (; lo < gNameIndex.count && gNameIndex.byHash[lo].hash == hash; lo++)
+		{
+			int id = gNameIndex.byHash[lo].id;
+			TestCase* test = gNameIndex.byId[id - 1];
+			detail::FlashStringIterator name(test->m_name);
+			if (detail::compareStrings_P(nameStart, nameEnd, name, name + name.len()))
+			{
+				func(test, id);
+			}
+		}
+		return;
+	}
+#endif
+
+	int id = 1;
+	for (TestCase* test = getFirst(); test; test = test->m_next, id++)
+	{
+		detail::FlashStringIterator name(test->m_name);
+		if (detail::compareStrings_P(nameStart, nameEnd, name, name + name.len()))
+		{
+			func(test, id);
+		}
+	}
+}
+
+TestCase* TestCase::findById(int id)
+{
+	if (id < 1 || id > ms_registry->getCount())
+	{
+		return nullptr;
+	}
+
+#if CZMUT_NAME_INDEX
+	if (updateNameIndex())
+	{
+		return gNameIndex.byId[id - 1];
+	}
+#endif
+
+	TestCase* test = getFirst();
+	while (--id)
+	{
+		test = test->m_next;
+	}
+	return test;
+}
+
+bool TestCase::filter(detail::FlashStringIterator tags, detail::FlashStringIterator nameStart, detail::FlashStringIterator nameEnd)
+{
+	auto setAll = [](bool enabled)
+	{
+		TestCase* test = getFirst();
+		while (test)
+		{
+			test->m_enabled = enabled;
+			test = test->m_next;
+		}
+	};
+
+	if (!tags || *tags == 0)
+	{
+		if (nameStart)
+		{
+			setAll(false);
+			forEachNamed(nameStart, nameEnd, [](TestCase* test, int) { test->m_enabled = true; });
+			gSelectedStaticTests = 0;
+		}
+		else
+		{
+			setAll(true);
+			gSelectedStaticTests = countStaticTests();
+		}
+		return true;
+	}
+	else
+	{
+		setAll(false);
+	}
+
+	//
+	// A token is composed of an optional test name pattern, followed by 0 or more tags, which we use to do a "AND".
+	// E.g, a token of "Parser*[foo][bar]" means the test name needs to start with "Parser", and the test needs to have
+	// a tag [foo] AND [bar] to be enabled
+	//
+	detail::FlashStringIterator tokenStart = tags;
+	detail::FlashStringIterator tokenEnd = tokenStart.findChar(',');
+	detail::FlashStringIterator tagsEnd = tags + tags.len();
+
+	#if CZMUT_DEBUG_FILTER
+	detail::logRange(F("Filter"), tags, tagsEnd);
+	#endif
+
+	while (tokenStart < tagsEnd)
+	{
+		if (!tokenEnd)
+		{
+			tokenEnd = tagsEnd;
+		}
+
+		#if CZMUT_DEBUG_FILTER
+		detail::logRange(F("    Token"), tokenStart, tokenEnd );
+		#endif
+
+		bool exclude = false;
+		if (*tokenStart == '~')
+		{
+			exclude = true;
+			++tokenStart;
+		}
+
+		detail::FlashStringIterator patternEnd = tokenStart.findChar('[');
+		if (!patternEnd || patternEnd > tokenEnd)
+		{
+			patternEnd = tokenEnd;
+		}
+
+		if (!isValidTagList(patternEnd, tokenEnd))
+		{
+			logN(F("Malformed filter\n"));
+			return false;
+		}
+
+		NamePatternKind kind = getNamePatternKind(tokenStart, patternEnd);
+
+		auto tryEnable = [&](TestCase* test, int id)
+		{
+			// If a test is already enabled as part of a previous token, then we can continue to the next one
+			if (test->m_enabled)
+			{
+				return;
+			}
+
+			bool matches = matchesNamePattern(test->m_name, id, kind, tokenStart, patternEnd) && hasAllTags(test->m_tags, patternEnd, tokenEnd);
+			if (matches != exclude)
+			{
+				#if CZMUT_DEBUG_FILTER
+				logN(F("                *** Marking test as ENABLED ***\n"));
+				#endif
+				test->m_enabled = true;
+			}
+		};
+
+		//
+		// Use the index where possible, so we don't need to check every test
+		//
+		if (nameStart)
+		{
+			forEachNamed(nameStart, nameEnd, tryEnable);
+		}
+		else if (!exclude && kind == NamePatternKind::Exact)
+		{
+			forEachNamed(tokenStart, patternEnd, tryEnable);
+		}
+		else if (!exclude && kind == NamePatternKind::Id)
+		{
+			int id = parseId(tokenStart, patternEnd);
+			TestCase* test = findById(id);
+			if (test)
+			{
+				tryEnable(test, id);
+			}
+		}
+		else
+		{
+			int id = 1;
+			for (TestCase* test = getFirst(); test; test = test->m_next, id++)
+			{
+				tryEnable(test, id);
+			}
+		}
+
+		tokenStart = tokenEnd + 1;
+		tokenEnd = tokenStart.findChar(',');
+	}
+
+	gSelectedStaticTests = nameStart ? 0 : countSelectedStaticTests(tags, tagsEnd);
+	return true;
+}
+
+int TestCase::countSelectedStaticTests(detail::FlashStringIterator tags, detail::FlashStringIterator tagsEnd)
+{
+	int count = 0;
+	for (const StaticTestInfo* test = firstStaticTest(); test; test = nextStaticTest(test))
+	{
+		const __FlashStringHelper* name = reinterpret_cast<const __FlashStringHelper*>(test->name);
+		const __FlashStringHelper* testTags = reinterpret_cast<const __FlashStringHelper*>(test->tags);
+
+		// Same as the tokens in filter. The expression was already validated
+		detail::FlashStringIterator tokenStart = tags;
+		while (tokenStart < tagsEnd)
+		{
+			detail::FlashStringIterator tokenEnd = tokenStart.findChar(',');
+			if (!tokenEnd)
+			{
+				tokenEnd = tagsEnd;
+			}
+
+			bool exclude = false;
+			if (*tokenStart == '~')
+			{
+				exclude = true;
+				++tokenStart;
+			}
+
+			detail::FlashStringIterator patternEnd = tokenStart.findChar('[');
+			if (!patternEnd || patternEnd > tokenEnd)
+			{
+				patternEnd = tokenEnd;
+			}
+
+			// Static tests don't have IDs, so an ID never matches them
+			NamePatternKind kind = getNamePatternKind(tokenStart, patternEnd);
+			bool matches = kind != NamePatternKind::Id && matchesNamePattern(name, 0, kind, tokenStart, patternEnd) &&
+				hasAllTags(testTags, patternEnd, tokenEnd);
+			if (matches != exclude)
+			{
+				count++;
+				break;
+			}
+
+			tokenStart = tokenEnd + 1;
+		}
+	}
+
+	return count;
+}
+
+namespace
+{
+	// Where the incremental runner is
+	struct RunState
+	{
+		// Test being run, or the next one to check
+		TestCase* test;
+		int entryIndex;
+		// ID of `test` (1 based position in the registration order)
+		int id;
+		// Set while an entry still has passes to run
+		bool inEntry;
+		// Set from begin until the run finishes
+		bool running;
+#if CZMUT_ISOLATION
+		// Position of the current entry, counting only the enabled tests (see IsolatedBatch)
+		int entryOrdinal;
+#endif
+		// Registry selected before a run started with begin(Registry&), to restore when the run finishes
+		Registry* previousRegistry;
+	} gRunState;
+
+	void restoreRegistry()
+	{
+		if (gRunState.previousRegistry)
+		{
+			setRegistry(*gRunState.previousRegistry);
+			gRunState.previousRegistry = nullptr;
+		}
+	}
+}
+
+void TestCase::begin()
+{
+	resetAll();
+
+	// Any assertions counted before the run are discarded
+	mergeThreadCounters();
+	memset(&gResults, 0, sizeof(gResults));
+
+	gRunState = RunState{};
+	gRunState.test = getFirst();
+	gRunState.id = 1;
+	gRunState.running = true;
+}
+
+bool TestCase::isRunning()
+{
+	return gRunState.running;
+}
+
+void TestCase::nextEntry()
+{
+	if (++gRunState.entryIndex >= gRunState.test->m_numEntries)
+	{
+		gRunState.entryIndex = 0;
+		gRunState.test = gRunState.test->m_next;
+		gRunState.id++;
+	}
+}
+
+bool TestCase::step()
+{
+	if (!gRunState.running)
+	{
+		return false;
+	}
+
+	if (!gRunState.inEntry)
+	{
+		while (gRunState.test && !gRunState.test->m_enabled)
+		{
+			gResults.testsSkipped += gRunState.test->m_numEntries;
+			gRunState.test = gRunState.test->m_next;
+			gRunState.id++;
+		}
+
+#if CZMUT_ISOLATION
+		if (gRunState.test && gIsolatedBatch.active &&
+			(gRunState.entryOrdinal < gIsolatedBatch.firstEntry || gRunState.entryOrdinal >= gIsolatedBatch.lastEntry))
+		{
+			// Not part of this batch. The parent process accounts for it
+			gRunState.entryOrdinal++;
+			nextEntry();
+			return true;
+		}
+#endif
+
+		if (!gRunState.test)
+		{
+			// Wait for any async tests still running, polling them once per step
+			if (AsyncTestCase::pollAll())
+			{
+				return true;
+			}
+
+			mergeThreadCounters();
+#if CZMUT_ISOLATION
+			if (!gIsolatedBatch.active)
+#endif
+			{
+				logFinalResults();
+			}
+			gRunState.running = false;
+			restoreRegistry();
+			return false;
+		}
+
+		TestCase* test = gRunState.test;
+		// Counting entries as they start, since a batch of runIsolated can start or stop in the middle of a test
+		gResults.testsRan++;
+		if (gRunState.entryIndex == 0)
+		{
+			CZMUT_NOTIFY(onTestStart, *test);
+		}
+#if CZMUT_ISOLATION
+		gRunState.entryOrdinal++;
+#endif
+
+		Entry& entry = test->m_entries[gRunState.entryIndex];
+		ms_activeEntry = &entry;
+		ms_active = test;
+		CZMUT_NOTIFY(onEntryStart, *test, entry.typeName);
+
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_NORMAL
+		if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_NORMAL))
+		{
+			// Print in two steps, because the second one is also PROGMEM
+			logN(F("RUNNING: Test ["), test->m_name);
+			if (entry.typeName)
+			{
+				logN(F("<"), entry.typeName, F(">"));
+			}
+			logN(F("], tags="), test->m_tags);
+	#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_VERBOSE
+			if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_VERBOSE))
+			{
+				logN(F(", id=#"), gRunState.id);
+			}
+	#endif
+			logN(F("\n"));
+		}
+#endif
+
+		if (entry.func == &asyncEntry)
+		{
+			// Async tests run alongside the others, and are polled between entries
+			static_cast<AsyncTestCase*>(test)->start();
+			ms_active = nullptr;
+			ms_activeEntry = nullptr;
+			nextEntry();
+			AsyncTestCase::pollAll();
+			return true;
+		}
+
+		testArenaBeginTest();
+		gRunState.inEntry = true;
+	}
+
+	TestCase* test = gRunState.test;
+	Entry& entry = test->m_entries[gRunState.entryIndex];
+	ms_activeEntry = &entry;
+	ms_active = test;
+
+	// One pass through the test per step
+	if (entry.rootSection.tryExecute())
+	{
+#if CZMUT_BASELINES
+		// Only paying for the clock if needed
+		std::chrono::steady_clock::time_point passStart;
+		if (gPassTimingHook)
+		{
+			passStart = std::chrono::steady_clock::now();
+		}
+#endif
+		{
+			AutoSection sec(entry.rootSection);
+			entry.func();
+		}
+#if CZMUT_BASELINES
+		if (gPassTimingHook)
+		{
+			auto durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - passStart).count();
+			gPassTimingHook(test, entry.typeName, Section::getLastExecuted(), static_cast<uint64_t>(durationNs));
+		}
+#endif
+		testArenaEndPass();
+		return true;
+	}
+
+	testArenaEndTest();
+	mergeThreadCounters();
+
+	CZMUT_NOTIFY(onEntryEnd, *test, entry.typeName);
+	if (gRunState.entryIndex + 1 == test->m_numEntries)
+	{
+		CZMUT_NOTIFY(onTestEnd, *test);
+	}
+
+	ms_active = nullptr;
+	ms_activeEntry = nullptr;
+	gRunState.inEntry = false;
+	nextEntry();
+	AsyncTestCase::pollAll();
+	return true;
+}
+
+bool TestCase::run()
+{
+	begin();
+	while (step())
+	{
+	}
+
+	return gResults.assertionsFailed ? false : true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// AsyncTestCase
+//////////////////////////////////////////////////////////////////////////
+
+AsyncTestCase* AsyncTestCase::ms_firstActive;
+
+void asyncEntry()
+{
+	// Never called. The runner resumes async tests through AsyncTestCase::pollAll
+	CZMUT_ASSERT(false);
+}
+
+AsyncTestCase::AsyncTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, const __FlashStringHelper* file, AsyncFunction func, unsigned long timeoutMs)
+	: TestCase(registry, name, tags)
+	, m_myEntries{ &asyncEntry }
+	, m_file(file)
+	, m_func(func)
+	, m_timeoutMs(timeoutMs)
+	, m_startMs(0)
+	, m_context{}
+{
+	setEntries(m_myEntries, 1);
+}
+
+void AsyncTestCase::start()
+{
+	m_context = AsyncContext{};
+	m_startMs = getMillis();
+	m_nextActive = ms_firstActive;
+	ms_firstActive = this;
+}
+
+bool AsyncTestCase::poll()
+{
+	ms_active = this;
+	ms_activeEntry = &m_myEntries[0];
+
+	bool done;
+	if (m_timeoutMs && (getMillis() - m_startMs) > m_timeoutMs)
+	{
+		logAssertionFailure(F("ASYNC TIMEOUT"), getFilename(m_file), m_context.resumePoint, F("Test didn't finish in time"));
+		m_context.cancel = true;
+		m_func(m_context);
+		done = true;
+	}
+	else
+	{
+		done = m_func(m_context);
+	}
+
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_VERBOSE
+	if (done && CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_VERBOSE))
+	{
+		logN(F("ASYNC DONE: Test ["), m_name, F("] in "), getMillis() - m_startMs, F(" ms\n"));
+	}
+#endif
+
+	if (done)
+	{
+		CZMUT_NOTIFY(onEntryEnd, *this, nullptr);
+		CZMUT_NOTIFY(onTestEnd, *this);
+	}
+
+	ms_active = nullptr;
+	ms_activeEntry = nullptr;
+	return done;
+}
+
+bool AsyncTestCase::pollAll()
+{
+	AsyncTestCase** prev = &ms_firstActive;
+	while (AsyncTestCase* test = *prev)
+	{
+		if (test->poll())
+		{
+			*prev = test->m_nextActive;
+		}
+		else
+		{
+			prev = &test->m_nextActive;
+		}
+	}
+
+	return ms_firstActive != nullptr;
+}
+
+void AsyncTestCase::resetAll()
+{
+	while (AsyncTestCase* test = ms_firstActive)
+	{
+		ms_firstActive = test->m_nextActive;
+		test->m_context.cancel = true;
+		test->m_func(test->m_context);
+		CZMUT_NOTIFY(onEntryEnd, *test, nullptr);
+		CZMUT_NOTIFY(onTestEnd, *test);
+	}
+}
+
+bool TestCase::isAsync() const
+{
+	return m_entries[0].func == &asyncEntry;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FuzzTestCase
+//////////////////////////////////////////////////////////////////////////
+
+FuzzCorpusEntry* FuzzCorpusEntry::ms_first;
+FuzzCorpusEntry* FuzzCorpusEntry::ms_last;
+
+FuzzCorpusEntry::FuzzCorpusEntry(const __FlashStringHelper* testName, const __FlashStringHelper* name, const uint8_t* data, size_t size)
+	: testName(testName)
+	, name(name)
+	, data(data)
+	, size(size)
+	, next(nullptr)
+{
+	// Adding at the end, so the entries are replayed in the order they are declared
+	if (ms_last)
+	{
+		ms_last->next = this;
+	}
+	else
+	{
+		ms_first = this;
+	}
+	ms_last = this;
+}
+
+void fuzzEntry()
+{
+	static_cast<FuzzTestCase*>(TestCase::getActive())->replayCorpus();
+}
+
+FuzzTestCase::FuzzTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, FuzzFunction func)
+	: TestCase(registry, name, tags)
+	, m_myEntries{ &fuzzEntry }
+	, m_func(func)
+{
+	setEntries(m_myEntries, 1);
+}
+
+void FuzzTestCase::replayCorpus()
+{
+	FlashStringIterator testName(m_name);
+	FlashStringIterator testNameEnd = testName + testName.len();
+	int count = 0;
+
+	for (const FuzzCorpusEntry* entry = FuzzCorpusEntry::ms_first; entry; entry = entry->next)
+	{
+		FlashStringIterator entryTestName(entry->testName);
+		if (!compareStrings_P(entryTestName, entryTestName + entryTestName.len(), testName, testNameEnd))
+		{
+			continue;
+		}
+
+		count++;
+		INFO("FUZZ_CORPUS [%s], %u bytes", entry->name, static_cast<unsigned int>(entry->size));
+#if CZMUT_AVR
+		// The fuzz target expects the input in RAM
+		uint8_t* data = static_cast<uint8_t*>(TestArena::allocate(entry->size ? entry->size : 1, 1));
+		if (!data)
+		{
+			return;
+		}
+		memcpy_P(data, entry->data, entry->size);
+		m_func(data, entry->size);
+		TestArena::deallocate(data, entry->size ? entry->size : 1);
 #else
-	return FlashStringIterator(strchr(m_pos + pos, ch));
+		m_func(entry->data, entry->size);
+#endif
+	}
+
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_NORMAL
+	if (count == 0 && CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_NORMAL))
+	{
+		logN(F("FUZZ: Test ["), m_name, F("] has no corpus\n"));
+	}
 #endif
 }
 
-FlashStringIterator FlashStringIterator::findLastChar(char ch) const
+#if CZMUT_FUZZ
+
+void FuzzTestCase::fuzzOne(const uint8_t* data, size_t size)
 {
-#if defined(ARDUINO)
-	return FlashStringIterator(strrchr_P(m_pos, ch));
+	static FuzzTestCase* target = []() -> FuzzTestCase*
+	{
+		const char* name = getenv("CZMUT_FUZZ_TEST");
+		for (TestCase* test = getFirst(); test; test = test->m_next)
+		{
+			if (test->m_entries[0].func == &fuzzEntry && (!name || strcmp(name, test->m_name) == 0))
+			{
+				return static_cast<FuzzTestCase*>(test);
+			}
+		}
+		return nullptr;
+	}();
+
+	if (!target)
+	{
+		CZMUT_LOG("FUZZ: No FUZZ_TEST found. Set CZMUT_FUZZ_TEST to the name of the test to fuzz\n");
+		abort();
+	}
+
+	ms_active = target;
+	ms_activeEntry = &target->m_myEntries[0];
+
+	int failed = gResults.assertionsFailed;
+	target->m_func(data, size);
+	if (gResults.assertionsFailed != failed)
+	{
+		// Lets libFuzzer know this input is a crash, so it stops and saves it
+		abort();
+	}
+
+	ms_active = nullptr;
+	ms_activeEntry = nullptr;
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// EQUIVALENCE_TEST
+//////////////////////////////////////////////////////////////////////////
+
+unsigned long getTicks()
+{
+#if CZMUT_DESKTOP
+	using namespace std::chrono;
+	return static_cast<unsigned long>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
 #else
-	return FlashStringIterator(strrchr(m_pos, ch));
+	return getMicros();
 #endif
 }
 
+void equivalenceMismatch(const __FlashStringHelper* file, int line, const __FlashStringHelper* expr, int input, const __FlashStringHelper* referenceName, const __FlashStringHelper* optimizedName, const FmtArg* values)
+{
+	INFO("Input #%d: %s and %s give different results", input, referenceName, optimizedName);
+#if CZMUT_INFO_CAPACITY
+	if (values)
+	{
+		ScopedInfo info(F("reference, optimized"), true, values[0], values[1]);
+		doCheck(false, file, line, expr);
+		return;
+	}
+#else
+	(void)values;
+#endif
+	doCheck(false, file, line, expr);
+}
+
+void finishEquivalence(const __FlashStringHelper* file, int line, int count, unsigned long long referenceTicks, unsigned long long optimizedTicks, double minSpeedup)
+{
+#if CZMUT_DESKTOP
+	constexpr double TicksPerUs = 1000;
+#else
+	constexpr double TicksPerUs = 1;
+#endif
+	double speedup = optimizedTicks ? static_cast<double>(referenceTicks) / static_cast<double>(optimizedTicks) : 0;
+
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_NORMAL
+	if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_NORMAL))
+	{
+		CZMUT_LOG("EQUIVALENCE: %d inputs. Reference %.3f us, optimized %.3f us. ", count, referenceTicks / TicksPerUs, optimizedTicks / TicksPerUs);
+		if (optimizedTicks)
+		{
+			CZMUT_LOG("Speedup %.2fx\n", speedup);
+		}
+		else
+		{
+			CZMUT_LOG("Too fast to measure the speedup\n");
+		}
+	}
+#endif
+
+	if (minSpeedup > 0)
+	{
+		INFO("Speedup %.2fx, minimum %.2fx", speedup, minSpeedup);
+		// If the optimized version takes no measurable time, it's only faster if the reference version does
+		doCheck(optimizedTicks ? speedup >= minSpeedup : referenceTicks > 0, file, line, F("speedup >= MinSpeedup"));
+	}
+}
+
+void doCheckLatency(const LatencyHistogramBase& histogram, double percentile, bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+{
+	if (!result)
+	{
+		INFO("p%.1f is %lu us. %lu samples. min %lu us, max %lu us", percentile, histogram.valueAtPercentile(percentile),
+			histogram.getCount(), histogram.getMin(), histogram.getMax());
+		doCheck(false, file, line, expr_str);
+		return;
+	}
+
+	doCheck(true, file, line, expr_str);
+}
+
+void doCheckDigest(uint32_t digest, uint32_t expected, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str)
+{
+	if (digest == expected)
+	{
+		doCheck(true, getFilename(file), line, expr_str);
+		return;
+	}
 
-//////////////////////////////////////////////////////////////////////////
-// Section
-//////////////////////////////////////////////////////////////////////////
-Section* Section::ms_active;
+#if CZMUT_DIGEST_RECORDING
+	if (isRecordingDigests() && recordDigest(file, line, expected, digest))
+	{
+	#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_NORMAL
+		if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_NORMAL))
+		{
+			CZMUT_LOG("DIGEST RECORDED: %s:%d 0x%08lx (was 0x%08lx)\n", getFilename(file), line, static_cast<unsigned long>(digest), static_cast<unsigned long>(expected));
+		}
+	#endif
+		doCheck(true, getFilename(file), line, expr_str);
+		return;
+	}
+#endif
 
-Section::Section(const __FlashStringHelper* name)
-	: m_name(name)
-	, m_state(State::Ready)
-	, m_childExecuted(false)
-	, m_hasActiveChild(false)
-{
+	INFO("Digest 0x%08lx, expected 0x%08lx", static_cast<unsigned long>(digest), static_cast<unsigned long>(expected));
+	doCheck(false, getFilename(file), line, expr_str);
 }
 
-Section::~Section()
+void logFinalResults()
 {
-	ms_active = m_parent;
+	LogLock lock;
+	mergeThreadCounters();
+	logN(gResults.testsRan, F(" tests ran. "), gResults.testsSkipped, F(" test skipped. "), gResults.testsFailed, F( " tests failed.\n"));
+	logN(gResults.assertions, F(" total assertions. "), gResults.assertionsFailed, F(" assertions failed.\n"));
+	if (gSelectedStaticTests)
+		logN(gSelectedStaticTests, F(" static tests verified at compile time.\n"));
+	logN(gResults.assertionsFailed ? F("**** FAILED ****\n") : F("**** SUCCESS ****\n"));
+
 }
 
-cz::mut::detail::Section* Section::getActive()
+cz::mut::detail::TestCase* TestCase::getActive()
 {
 	return ms_active;
 }
 
-const __FlashStringHelper* Section::getName() const
+const __FlashStringHelper* TestCase::getActiveTestType()
+{
+	Entry* entry = ms_activeEntry;
+	return entry ? entry->typeName : nullptr;
+}
+
+const __FlashStringHelper* TestCase::getName() const
 {
 	return m_name;
 }
 
-bool Section::tryExecute()
+bool TestCase::hasTag(const __FlashStringHelper* testTags, detail::FlashStringIterator tagStart, detail::FlashStringIterator tagEnd)
 {
-	if ((m_parent && m_parent->m_childExecuted) || (m_state == State::Finished))
+	//
+	// Iterate through all the test tags and check if we have the specified tag
+	// 
+	#if CZMUT_DEBUG_FILTER
+	logN(F("            Checking if tags "), testTags, F(" have tag "));
+	detail::logRange(tagStart, tagEnd);
+	logN(F("\n"));
+	#endif
+
+	detail::FlashStringIterator testTagStart = detail::FlashStringIterator(testTags);
+	detail::FlashStringIterator testTagEnd = testTagStart.findChar('[', 1);
+	while (*testTagStart)
 	{
-		return false;
+		if (!testTagEnd)
+		{
+			testTagEnd = testTagStart + testTagStart.len();
+
+			if (*(testTagEnd-1) != ']')
+			{
+				logN(F("Malformed tag: "), testTagStart.c_str());
+				return false;
+			}
+		}
+
+		#if CZMUT_DEBUG_FILTER
+		detail::logRange(F("                testTag"), testTagStart, testTagEnd);
+		#endif
+
+		if (detail::compareStrings_P(testTagStart, testTagEnd, tagStart, tagEnd))
+		{
+			return true;
+		}
+
+		testTagStart = testTagEnd;
+		testTagEnd = testTagStart.findChar('[', 1);
 	}
 
-	m_state = State::Running;
-	m_childExecuted = false;
-	m_hasActiveChild = false;
-	if (m_parent)
+	return false;
+}
+
+bool TestCase::hasAllTags(const __FlashStringHelper* testTags, detail::FlashStringIterator tagStart, detail::FlashStringIterator tagsEnd)
+{
+	while (tagStart < tagsEnd)
 	{
-		m_parent->m_childExecuted = true;
+		detail::FlashStringIterator tagEnd = tagStart.findChar('[', 1);
+		if (!tagEnd || tagEnd > tagsEnd)
+		{
+			tagEnd = tagsEnd;
+		}
+
+		#if CZMUT_DEBUG_FILTER
+		detail::logRange(F("        tag"), tagStart, tagEnd);
+		#endif
+
+		if (!hasTag(testTags, tagStart, tagEnd))
+		{
+			return false;
+		}
+
+		tagStart = tagEnd;
 	}
+
 	return true;
 }
 
-void Section::start()
+void TestCase::resetAll()
 {
-	if (ms_active == nullptr)
+	for (TestCase* test = getFirst(); test; test = test->m_next)
 	{
-		ms_active = this;
-		m_parent = nullptr;
+		test->m_failed = false;
 	}
-	else
+
+	AsyncTestCase::resetAll();
+
+	// This also resets the entries root sections, since those are started like any other section
+	Section::resetAll();
+	ms_active = nullptr;
+	ms_activeEntry = nullptr;
+}
+
+int TestCase::countEnabledTests()
+{
+	int totalEnabledTest = 0;
+	const TestCase* test = getFirst();
+	while (test)
 	{
-		m_parent = ms_active;
-		ms_active = this;
-		m_parent->onChildStart();
+		if (test->m_enabled)
+			totalEnabledTest++;
+		test = test->m_next;
 	}
+	return totalEnabledTest;
 }
 
-void Section::end()
+} // cz::mut::detail
+
+namespace cz::mut
 {
-	if (m_state == State::Ready)
+
+void flushlog()
+{
+	detail::flushlog();
+}
+
+const char* getFilename(const char* file)
+{
+	const char* a = strrchr(file, '\\');
+	const char* b = strrchr(file, '/');
+	const char* c = a > b ? a : b;
+	return c ? c+1 : file;
+}
+
+#if defined(ARDUINO)
+const __FlashStringHelper* getFilename(const __FlashStringHelper* file)
+{
+	detail::FlashStringIterator a = detail::FlashStringIterator(file).findLastChar('\\');
+	detail::FlashStringIterator b = detail::FlashStringIterator(file).findLastChar('/');
+	detail::FlashStringIterator c = a > b ? a : b;
+	return c ? (c+1).data() : file;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// LatencyHistogram
+//////////////////////////////////////////////////////////////////////////
+
+//
+// Values below 2^(subBucketBits+1) have a bucket each. Above that, each power of two range [2^n, 2^(n+1)) is split into
+// 2^subBucketBits buckets.
+//
+int LatencyHistogramBase::bucketIndex(unsigned long value) const
+{
+	const unsigned long subBuckets = 1UL << m_subBucketBits;
+	if (value < subBuckets * 2)
 	{
-		// If the state is "Ready", it means we are skipping this section. As-in, tryExecute failed
+		return static_cast<int>(value);
 	}
-	else if (m_state == State::Running)
+
+	int msb = 0;
+	for (unsigned long v = value; v >>= 1;)
 	{
-		if (m_hasActiveChild)
-		{
-			m_state = State::Ready;
-		}
-		else
-		{
-			m_state = State::Finished;
-		}
+		msb++;
 	}
-	else if (m_state == State::Finished)
+
+	// Values above 2^ValueBits - 1 go to the last bucket. Clamping the index instead of checking the value avoids
+	// shifting by the width of the type, since unsigned long can be 32 or 64 bits.
+	int shift = msb - m_subBucketBits;
+	int index = static_cast<int>(((shift + 1) << m_subBucketBits) + ((value >> shift) - subBuckets));
+	return index < numBuckets() ? index : numBuckets() - 1;
+}
+
+unsigned long LatencyHistogramBase::bucketHighestValue(int index) const
+{
+	const int subBuckets = 1 << m_subBucketBits;
+	if (index < subBuckets * 2)
 	{
-		//
+		return static_cast<unsigned long>(index);
 	}
-	else
+
+	int shift = (index >> m_subBucketBits) - 1;
+	unsigned long lowest = static_cast<unsigned long>((index & (subBuckets - 1)) + subBuckets) << shift;
+	return lowest + ((1UL << shift) - 1);
+}
+
+int LatencyHistogramBase::numBuckets() const
+{
+	return (m_valueBits - m_subBucketBits + 1) << m_subBucketBits;
+}
+
+void LatencyHistogramBase::record(unsigned long value)
+{
+	uint32_t& bucket = m_buckets[bucketIndex(value)];
+	// Saturate instead of wrapping around, which would throw off the percentiles completely
+	if (bucket != UINT32_MAX)
 	{
-		CZMUT_ASSERT(false);
+		bucket++;
 	}
 
-	if (m_parent)
+	m_count++;
+	m_min = value < m_min ? value : m_min;
+	m_max = value > m_max ? value : m_max;
+}
+
+void LatencyHistogramBase::reset()
+{
+	memset(m_buckets, 0, numBuckets() * sizeof(*m_buckets));
+	m_count = 0;
+	m_min = ~0UL;
+	m_max = 0;
+}
+
+unsigned long LatencyHistogramBase::valueAtPercentile(double percentile) const
+{
+	if (m_count == 0)
 	{
-		m_parent->onChildEnd(m_state);
-		ms_active = m_parent;
+		return 0;
 	}
-	else
+
+	if (percentile >= 100)
 	{
-		ms_active = nullptr;
+		return m_max;
+	}
+
+	// Number of values that need to be at or below the result
+	double rank = percentile * m_count / 100;
+	unsigned long target = static_cast<unsigned long>(rank);
+	target += (target < rank || target == 0) ? 1 : 0;
+
+	unsigned long total = 0;
+	int count = numBuckets();
+	for (int index = 0; index < count; index++)
+	{
+		total += m_buckets[index];
+		if (total >= target)
+		{
+			unsigned long value = bucketHighestValue(index);
+			return value < m_max ? value : m_max;
+		}
 	}
+
+	return m_max;
 }
 
-void Section::onChildStart()
+void LatencyHistogramBase::log(const __FlashStringHelper* name) const
 {
+	CZMUT_LOG("LATENCY [%s]: %lu samples. min %lu us, p50 %lu us, p99 %lu us, p99.9 %lu us, max %lu us\n",
+		name, m_count, getMin(), valueAtPercentile(50), valueAtPercentile(99), valueAtPercentile(99.9), m_max);
 }
 
-void Section::onChildEnd(State childState)
+//////////////////////////////////////////////////////////////////////////
+// Digests
+//////////////////////////////////////////////////////////////////////////
+
+namespace
 {
-	if (childState == State::Ready)
+#if CZMUT_DESKTOP
+	// One lookup per byte
+	struct Crc32Table
 	{
-		m_hasActiveChild = true;
+		constexpr Crc32Table()
+			: entries{}
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+				}
+				entries[i] = crc;
+			}
+		}
+
+		uint32_t entries[256];
+	};
+
+	constexpr Crc32Table gCrc32Table;
+#else
+	// One lookup per nibble, so the table only takes 64 bytes of flash
+	const uint32_t gCrc32Nibbles[16] PROGMEM =
+	{
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	uint32_t crc32Nibble(uint32_t crc)
+	{
+	#if defined(ARDUINO)
+		return pgm_read_dword(&gCrc32Nibbles[crc & 0xF]) ^ (crc >> 4);
+	#else
+		return gCrc32Nibbles[crc & 0xF] ^ (crc >> 4);
+	#endif
 	}
+#endif
 }
 
+uint32_t crc32(const void* data, size_t size, uint32_t crc)
+{
+	const uint8_t* ptr = static_cast<const uint8_t*>(data);
+	crc = ~crc;
+	while (size--)
+	{
+#if CZMUT_DESKTOP
+		crc = gCrc32Table.entries[(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+#else
+		crc ^= *ptr++;
+		crc = crc32Nibble(crc);
+		crc = crc32Nibble(crc);
+#endif
+	}
+	return ~crc;
+}
 
 //////////////////////////////////////////////////////////////////////////
 // TestCase
 //////////////////////////////////////////////////////////////////////////
+bool run(const __FlashStringHelper* tags)
+{
+	if (!begin(tags))
+	{
+		return false;
+	}
 
-TestCase* TestCase::ms_first;
-TestCase* TestCase::ms_last;
-TestCase* TestCase::ms_active;
-TestCase::Entry* TestCase::ms_activeEntry;
+	while (step())
+	{
+	}
 
-TestCase::TestCase(const __FlashStringHelper* name, const __FlashStringHelper* tags)
-	: m_name(name)
-	, m_tags(tags)
-	, m_enabled(false)
-	, m_failed(false)
+	return getSummary().passed();
+}
+
+bool begin(const __FlashStringHelper* tags)
+{
+	return detail::beginRun(detail::FlashStringIterator(tags));
+}
+
+namespace registries
+{
+	Registry global;
+}
+
+void setRegistry(Registry& registry)
+{
+	detail::TestCase::ms_registry = &registry;
+}
+
+Registry& getRegistry()
 {
-	if (ms_first == nullptr)
+	return *detail::TestCase::ms_registry;
+}
+
+bool run(Registry& registry, const __FlashStringHelper* tags)
+{
+	if (!begin(registry, tags))
+	{
+		return false;
+	}
+
+	while (step())
 	{
-		ms_last = ms_first = this;
 	}
-	else
+
+	return getSummary().passed();
+}
+
+bool begin(Registry& registry, const __FlashStringHelper* tags)
+{
+	// If a run of another registry didn't finish, its selection is undone first, so this run restores the right one
+	detail::restoreRegistry();
+	Registry& previous = getRegistry();
+	setRegistry(registry);
+	if (!begin(tags))
 	{
-		ms_last->m_next = this;
-		ms_last = this;
+		setRegistry(previous);
+		return false;
 	}
-}
 
-TestCase::~TestCase()
-{
+	detail::gRunState.previousRegistry = &previous;
+	return true;
 }
-bool TestCase::filter(detail::FlashStringIterator tags)
-{
-	auto setAll = [](bool enabled)
-	{
-		TestCase* test = ms_first;
-		while (test)
-		{
-			test->m_enabled = enabled;
-			test = test->m_next;
-		}
-	};
 
-	if (!tags || *tags == 0)
+bool detail::selectTests(detail::FlashStringIterator tags)
+{
+	if (!detail::TestCase::filter(tags))
 	{
-		setAll(true);
-		return true;
+		return false;
 	}
-	else
+
+	if (detail::TestCase::countEnabledTests()==0)
 	{
-		setAll(false);
+		logN(F("No tests enabled (check your tag expression)\n"));
+		logN(F("**** FAILED ****\n"));
+		return false;
 	}
 
-	//
-	// A token is composed of 1 or more tags, which we use to do a "AND". E.g, a token of "[foo][bar]" means
-	// the test needs to have a tag [foo] AND [bar] to be enabled
-	//
-	detail::FlashStringIterator tokenStart = tags;
-	detail::FlashStringIterator tokenEnd = tokenStart.findChar(',');
-	detail::FlashStringIterator tagsEnd = tags + tags.len();
+	return true;
+}
 
-	#if CZMUT_DEBUG_FILTER
-	detail::logRange(F("Filter"), tags, tagsEnd);
-	#endif
+bool detail::beginRun(detail::FlashStringIterator tags)
+{
+	// A run started with begin(Registry&) that didn't finish
+	restoreRegistry();
 
-	while (tokenStart < tagsEnd)
+	if (!selectTests(tags))
 	{
-		if (!tokenEnd)
-		{
-			tokenEnd = tagsEnd;
-		}
-
-		#if CZMUT_DEBUG_FILTER
-		detail::logRange(F("    Token"), tokenStart, tokenEnd );
-		#endif
+		return false;
+	}
 
-		bool exclude = false;
-		if (*tokenStart == '~')
-		{
-			exclude = true;
-			++tokenStart;
-		}
+	detail::TestCase::begin();
+	return true;
+}
 
-		TestCase* test = ms_first;
-		while (test)
-		{
-			// If a test is already enabled as part of a previous token, then we can continue to the next one
-			if (test->m_enabled)
-			{
-				test = test->m_next;
-				continue;
-			}
+bool step()
+{
+	return detail::TestCase::step();
+}
 
-			//
-			// Iterate through all the individual tags in the token, and compare with the test tags
-			//
-			detail::FlashStringIterator tagStart = tokenStart;
-			detail::FlashStringIterator tagEnd = tagStart.findChar('[', 1);
-			bool hasAllTags = true;
-			while (tagStart < tokenEnd)
-			{
-				if (!tagEnd)
-				{
-					tagEnd = tagStart + tagStart.len();
-				}
-				else if (tagEnd > tokenEnd)
-				{
-					tagEnd = tokenEnd;
-				}
+bool isDone()
+{
+	return !detail::TestCase::isRunning();
+}
 
+#if CZMUT_LISTENERS
+void addListener(Listener& listener)
+{
+	Listener** last = &detail::ListenerAccess::first;
+	while (*last)
+	{
+		last = &detail::ListenerAccess::next(**last);
+	}
+	*last = &listener;
+	listener.m_nextListener = nullptr;
+}
 
-				#if CZMUT_DEBUG_FILTER
-				detail::logRange(F("        tag"), tagStart, tagEnd);
-				#endif
+void removeListener(Listener& listener)
+{
+	for (Listener** it = &detail::ListenerAccess::first; *it; it = &detail::ListenerAccess::next(**it))
+	{
+		if (*it == &listener)
+		{
+			*it = listener.m_nextListener;
+			listener.m_nextListener = nullptr;
+			return;
+		}
+	}
+}
 
-				if (*tagStart != '[' || *(tagEnd-1) != ']')
-				{
-					logN(F("Malformed filter\n"));
-					return false;
-				}
+#if CZMUT_ISOLATION
+void detail::detachListeners()
+{
+	ListenerAccess::first = nullptr;
+}
+#endif
+#endif
 
-				if (!test->hasTag(tagStart, tagEnd))
-				{
-					hasAllTags = false;
-					// A test must have all the tags in a token in order to be enabled, so if we fail to match even one, this test
-					// if considered disabled
-					break;
-				}
+Summary getSummary()
+{
+	detail::mergeThreadCounters();
+	Summary summary;
+	summary.testsRan = detail::gResults.testsRan;
+	summary.testsSkipped = detail::gResults.testsSkipped;
+	summary.testsFailed = detail::gResults.testsFailed;
+	summary.assertions = detail::gResults.assertions;
+	summary.assertionsFailed = detail::gResults.assertionsFailed;
+	return summary;
+}
 
-				tagStart = tagEnd;
-				tagEnd = tagStart.findChar('[', 1);
-			}
+//////////////////////////////////////////////////////////////////////////
+// TestArena
+//////////////////////////////////////////////////////////////////////////
 
-			if ((hasAllTags && !exclude) || (!hasAllTags && exclude))
-			{
-					#if CZMUT_DEBUG_FILTER
-					if (!test->m_enabled)
-						logN(F("                *** Marking test as ENABLED ***\n"));
-					#endif
-				test->m_enabled = true;
-			}
+void TestArena::deallocate(void* ptr, size_t size)
+{
+	// Nothing to do if the pointer is null or the arena was already rewound
+	if (!ptr || detail::gTestArena.liveAllocations == 0)
+	{
+		return;
+	}
 
-			test = test->m_next;
-		}
+	detail::gTestArena.liveAllocations--;
+	detail::gTestArena.liveBytes -= size;
 
-		tokenStart = tokenEnd + 1;
-		tokenEnd = tokenStart.findChar(',');
+	if (detail::gTestArena.liveAllocations == 0)
+	{
+		detail::gTestArena.used = 0;
+	}
+	else if (static_cast<unsigned char*>(ptr) + size == detail::gTestArena.buffer + detail::gTestArena.used)
+	{
+		// Last allocation, so we can reclaim it
+		detail::gTestArena.used -= size;
 	}
+}
 
-	return true;
+size_t TestArena::getUsed()
+{
+	return detail::gTestArena.used;
 }
 
-bool TestCase::run()
+size_t TestArena::getPeak()
 {
-	TestCase* test = ms_first;
-	ms_active = nullptr;
-	ms_activeEntry = nullptr;
+	return detail::gTestArena.peak;
+}
 
-	memset(&gResults, 0, sizeof(gResults));
-	int totalTestCalls = 0;
+size_t TestArena::getLiveAllocations()
+{
+	return detail::gTestArena.liveAllocations;
+}
 
-	while (test)
+#if CZMUT_HAS_PMR
+namespace
+{
+	class TestArenaResource : public std::pmr::memory_resource
 	{
-		if (test->m_enabled)
+		void* do_allocate(size_t bytes, size_t alignment) override
 		{
-			gResults.testsRan += test->m_numEntries;
-			for(int entryIndex=0; entryIndex<test->m_numEntries; entryIndex++)
+			void* ptr = TestArena::allocate(bytes, alignment);
+			if (!ptr)
 			{
-				ms_activeEntry = &test->m_entries[entryIndex];
-				ms_active = test;
-
-				// Print in two steps, because the second one is also PROGMEM
-				logN(F("RUNNING: Test ["), test->m_name);
-				if (ms_active->getActiveTestType())
-				{
-					logN(F("<"), ms_active->getActiveTestType(), F(">"));
-				}
-				logN(F("], tags="), test->m_tags, F("\n"));
-
-				while(ms_activeEntry->rootSection.tryExecute())
-				{
-					totalTestCalls++;
-					AutoSection sec(ms_activeEntry->rootSection);
-					ms_activeEntry->func();
-				}
+				throw std::bad_alloc();
 			}
+			return ptr;
 		}
-		else
+
+		void do_deallocate(void* ptr, size_t bytes, size_t /*alignment*/) override
 		{
-			gResults.testsSkipped += test->m_numEntries;
+			TestArena::deallocate(ptr, bytes);
 		}
 
-		test = test->m_next;
-	}
-
-	logFinalResults();
-
-	ms_active = nullptr;
-	ms_activeEntry = nullptr;
-	return gResults.assertionsFailed ? false : true;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
 }
 
-void logFinalResults()
+std::pmr::memory_resource* TestArena::getResource()
 {
-	logN(gResults.testsRan, F(" tests ran. "), gResults.testsSkipped, F(" test skipped. "), gResults.testsFailed, F( " tests failed.\n"));
-	logN(gResults.assertions, F(" total assertions. "), gResults.assertionsFailed, F(" assertions failed.\n"));
-	logN(gResults.assertionsFailed ? F("**** FAILED ****\n") : F("**** SUCCESS ****\n"));
-
+	static TestArenaResource resource;
+	return &resource;
 }
+#endif
 
-cz::mut::detail::TestCase* TestCase::getActive()
+bool runRepeat(const __FlashStringHelper* tags, unsigned long count, unsigned long durationMs, bool stopOnFailure)
 {
-	return ms_active;
+	return detail::runRepeat(detail::FlashStringIterator(tags), count, durationMs, stopOnFailure);
 }
 
-const __FlashStringHelper* TestCase::getActiveTestType()
+bool detail::runRepeat(detail::FlashStringIterator tags, unsigned long count, unsigned long durationMs, bool stopOnFailure)
 {
-	return (ms_activeEntry) ? ms_activeEntry->typeName : nullptr;
-}
+	if (count == 0 && durationMs == 0)
+	{
+		logN(F("runRepeat needs a count or a duration\n"));
+		return false;
+	}
 
-const __FlashStringHelper* TestCase::getName() const
-{
-	return m_name;
-}
+	// Otherwise every iteration would fail the same way, until the count or the duration runs out
+	restoreRegistry();
+	if (!selectTests(tags))
+	{
+		return false;
+	}
 
-bool TestCase::hasTag(detail::FlashStringIterator tagStart, detail::FlashStringIterator tagEnd) const
-{
-	//
-	// Iterate through all the test tags and check if we have the specified tag
-	// 
-	#if CZMUT_DEBUG_FILTER
-	logN(F("            Checking if Test '"), m_name, F("'(tags="), m_tags, F(") has tag "));
-	detail::logRange(tagStart, tagEnd);
-	logN(F("\n"));
-	#endif
+	unsigned long iterations = 0;
+	unsigned long failedIterations = 0;
+	unsigned long minTimeUs = 0;
+	unsigned long maxTimeUs = 0;
+	unsigned long long totalTimeUs = 0;
+	unsigned long long totalAssertions = 0;
+	unsigned long long totalAssertionsFailed = 0;
+	unsigned long startMs = getMillis();
 
-	detail::FlashStringIterator testTagStart = detail::FlashStringIterator(m_tags);
-	detail::FlashStringIterator testTagEnd = testTagStart.findChar('[', 1);
-	while (*testTagStart)
+	while ((count == 0 || iterations < count) && (durationMs == 0 || (getMillis() - startMs) < durationMs))
 	{
-		if (!testTagEnd)
+		iterations++;
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_VERBOSE
+		if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_VERBOSE))
 		{
-			testTagEnd = testTagStart + testTagStart.len();
+			logN(F("ITERATION "), iterations, F(" started\n"));
+		}
+#endif
 
-			if (*(testTagEnd-1) != ']')
+		unsigned long iterationStartUs = getMicros();
+		bool passed = false;
+		if (beginRun(tags))
+		{
+			while (step())
 			{
-				logN(F("Malformed tag: "), testTagStart.c_str());
-				return false;
 			}
+			passed = getSummary().passed();
 		}
-
-		#if CZMUT_DEBUG_FILTER
-		detail::logRange(F("                testTag"), testTagStart, testTagEnd);
-		#endif
-
-		if (detail::compareStrings_P(testTagStart, testTagEnd, tagStart, tagEnd))
+		unsigned long timeUs = getMicros() - iterationStartUs;
+
+		if (iterations == 1 || timeUs < minTimeUs)
+			minTimeUs = timeUs;
+		if (timeUs > maxTimeUs)
+			maxTimeUs = timeUs;
+		totalTimeUs += timeUs;
+		totalAssertions += detail::gResults.assertions;
+		totalAssertionsFailed += detail::gResults.assertionsFailed;
+
+#if CZMUT_COMPILE_TIME_VERBOSITY >= CZMUT_VERBOSITY_NORMAL
+		if (CZMUT_VERBOSITY_ENABLED(CZMUT_VERBOSITY_NORMAL))
 		{
-			return true;
+			logN(F("ITERATION "), iterations, passed ? F(" passed. ") : F(" FAILED. "), timeUs, F(" us\n"));
 		}
+#endif
 
-		testTagStart = testTagEnd;
-		testTagEnd = testTagStart.findChar('[', 1);
+		if (!passed)
+		{
+			failedIterations++;
+			if (stopOnFailure)
+			{
+				break;
+			}
+		}
 	}
 
-	return false;
+	logN(F("REPEAT: "), iterations, F(" iterations. "), failedIterations, F(" iterations failed.\n"));
+	logN(F("REPEAT: Time per iteration (us): min="), minTimeUs, F(", avg="), totalTimeUs / iterations, F(", max="), maxTimeUs, F("\n"));
+	logN(F("REPEAT: "), totalAssertions, F(" total assertions. "), totalAssertionsFailed, F(" assertions failed.\n"));
+	logN(failedIterations ? F("**** REPEAT FAILED ****\n") : F("**** REPEAT SUCCESS ****\n"));
+
+	return failedIterations == 0;
 }
 
-int TestCase::countEnabledTests()
+void reset()
 {
-	int totalEnabledTest = 0;
-	const TestCase* test = ms_first;
-	while (test)
-	{
-		if (test->m_enabled)
-			totalEnabledTest++;
-		test = test->m_next;
-	}
-	return totalEnabledTest;
+	detail::TestCase::resetAll();
 }
 
-} // cz::mut::detail
-
-namespace cz::mut
+void setVerbosity(Verbosity verbosity)
 {
+	detail::gVerbosity = verbosity;
+}
 
-void flushlog()
+Verbosity getVerbosity()
 {
-	detail::flushlog();
+	return detail::gVerbosity;
 }
 
-const char* getFilename(const char* file)
+unsigned long getMillis()
 {
-	const char* a = strrchr(file, '\\');
-	const char* b = strrchr(file, '/');
-	const char* c = a > b ? a : b;
-	return c ? c+1 : file;
+#if CZMUT_DESKTOP
+	using namespace std::chrono;
+	return static_cast<unsigned long>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+#elif CZMUT_ARDUINO
+	return millis();
+#else
+	#error Unknown or unsupported platform
+#endif
 }
 
-#if defined(ARDUINO)
-const __FlashStringHelper* getFilename(const __FlashStringHelper* file)
+unsigned long getMicros()
 {
-	detail::FlashStringIterator a = detail::FlashStringIterator(file).findLastChar('\\');
-	detail::FlashStringIterator b = detail::FlashStringIterator(file).findLastChar('/');
-	detail::FlashStringIterator c = a > b ? a : b;
-	return c ? (c+1).data() : file;
-}
+#if CZMUT_DESKTOP
+	using namespace std::chrono;
+	return static_cast<unsigned long>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+#elif CZMUT_ARDUINO
+	return micros();
+#else
+	#error Unknown or unsupported platform
 #endif
+}
 
-//////////////////////////////////////////////////////////////////////////
-// TestCase
-//////////////////////////////////////////////////////////////////////////
-bool run(const __FlashStringHelper* tags)
+bool run(const __FlashStringHelper* tags, const __FlashStringHelper* sectionPath)
 {
-	if (!detail::TestCase::filter(detail::FlashStringIterator(tags)))
+	if (!sectionPath)
 	{
-		return false;
+		return run(tags);
 	}
 
+	// First element is the test name
+	detail::FlashStringIterator nameStart(sectionPath);
+	detail::FlashStringIterator nameEnd = nameStart.findChar('/');
+	bool hasSections = nameEnd ? true : false;
+	if (!hasSections)
+	{
+		nameEnd = nameStart + nameStart.len();
+	}
+
+	if (!detail::TestCase::filter(detail::FlashStringIterator(tags), nameStart, nameEnd))
+	{
+		return false;
+	}
 	if (detail::TestCase::countEnabledTests()==0)
 	{
-		logN(F("No tests enabled (check your tag expression)\n"));
+		logN(F("No tests enabled (check your tag expression and test name)\n"));
+		logN(F("**** FAILED ****\n"));
+		return false;
+	}
+
+	if (!hasSections)
+	{
+		return detail::TestCase::run();
+	}
+
+	detail::Section::setFilterPath((nameEnd + 1).data());
+	bool res = detail::TestCase::run();
+	bool matched = detail::Section::hasMatchedFilterPath();
+	detail::Section::setFilterPath(nullptr);
+
+	if (!matched)
+	{
+		logN(F("No section matches the path ["), sectionPath, F("]\n"));
 		logN(F("**** FAILED ****\n"));
 		return false;
 	}
 
-	return detail::TestCase::run();
+	return res;
 }
 
 } // cz::mut
 
+
+#if CZMUT_FUZZ
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	cz::mut::detail::FuzzTestCase::fuzzOne(data, size);
+	return 0;
+}
+#endif
@@ -10,7 +10,7 @@
 	#endif
 #endif
 
-#ifdef _WIN32
+#if !defined(ARDUINO) && (defined(_WIN32) || defined(__linux__) || defined(__APPLE__))
 	#define CZMUT_DESKTOP 1
 #else
 	#define CZMUT_DESKTOP 0
@@ -32,6 +32,14 @@
 	#define CZMUT_RP2040 0
 #endif
 
+//
+// Thread safe assertions and reporting.
+// Enabled by default on desktop platforms, so tests can spawn threads that use CHECK/REQUIRE.
+//
+#ifndef CZMUT_THREADS
+	#define CZMUT_THREADS CZMUT_DESKTOP
+#endif
+
 #if defined(ARDUINO)
 	#define CZMUT_ARDUINO 1
 	#include <Arduino.h>
@@ -62,11 +70,19 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #if CZMUT_DESKTOP
 	#include <stdlib.h>
 #endif
-#include "./helpers/vaargs_to_string_array.h"
+#if CZMUT_THREADS
+	#include <atomic>
+	// State shared between the thread running the tests and any threads spawned by the tests
+	#define CZMUT_ATOMIC(Type) std::atomic<Type>
+#else
+	#define CZMUT_ATOMIC(Type) Type
+#endif
 #include "./helpers/static_string.h"
+#include "./helpers/type_list.h"
 
 #define CZMUT_CONCATENATE_IMPL(s1,s2) s1##s2
 #define CZMUT_CONCATENATE(s1,s2) CZMUT_CONCATENATE_IMPL(s1,s2)
@@ -80,43 +96,1115 @@
 		CZMUT_CONCATENATE(str,__LINE__)
 #endif
 
-#ifndef CZMUT_COMPILE_TIME_TAGS
-	#define CZMUT_COMPILE_TIME_TAGS ""
-#endif
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+//
+// Registry the tests in a translation unit are added to (see cz::mut::Registry).
+// To use a different one, define this before including mut.h, or with #undef/#define in the middle of a file, and
+// declare the registry with CZMUT_DECLARE_REGISTRY.
+//
+#ifndef CZMUT_REGISTRY
+	#define CZMUT_REGISTRY global
+#endif
+
+//
+// Size (in bytes) of the arena used to construct fixtures (see TEST_CASE_METHOD).
+// Only one fixture is alive at any given time, so this needs to be as big as the biggest fixture in the binary, and it
+// needs to have the same value in all translation units.
+// The arena only takes RAM if there is at least one TEST_CASE_METHOD.
+//
+#ifndef CZMUT_FIXTURE_ARENA_SIZE
+	#if CZMUT_DESKTOP
+		#define CZMUT_FIXTURE_ARENA_SIZE 4096
+	#elif CZMUT_AVR
+		#define CZMUT_FIXTURE_ARENA_SIZE 64
+	#else
+		#define CZMUT_FIXTURE_ARENA_SIZE 256
+	#endif
+#endif
+
+// Biggest alignment any fundamental type can have
+#ifndef CZMUT_MAX_ALIGN
+	#if defined(__BIGGEST_ALIGNMENT__)
+		#define CZMUT_MAX_ALIGN __BIGGEST_ALIGNMENT__
+	#else
+		#define CZMUT_MAX_ALIGN 16
+	#endif
+#endif
+
+#ifndef CZMUT_FIXTURE_ARENA_ALIGN
+	#define CZMUT_FIXTURE_ARENA_ALIGN CZMUT_MAX_ALIGN
+#endif
+
+//
+// Size (in bytes) of the buffer used by cz::mut::TestArena.
+// The buffer only takes RAM if TestArena is used.
+//
+#ifndef CZMUT_TEST_ARENA_SIZE
+	#if CZMUT_DESKTOP
+		#define CZMUT_TEST_ARENA_SIZE (64*1024)
+	#elif CZMUT_AVR
+		#define CZMUT_TEST_ARENA_SIZE 256
+	#else
+		#define CZMUT_TEST_ARENA_SIZE 4096
+	#endif
+#endif
+
+//
+// If set to 1, an index of the tests by name and ID is built (once, on the heap) the first time it's needed, so selecting
+// tests by exact name or ID doesn't need to compare the names of all the tests.
+// Disabled by default on AVR, where RAM is scarce and there is no need for the extra speed.
+//
+#ifndef CZMUT_NAME_INDEX
+	#if CZMUT_AVR
+		#define CZMUT_NAME_INDEX 0
+	#else
+		#define CZMUT_NAME_INDEX 1
+	#endif
+#endif
+
+//
+// Size of the buffer used by INFO and CAPTURE. Context that doesn't fit drops the oldest entries.
+// CZMUT_INFO_CAPACITY is the number of INFO/CAPTURE in scope, and CZMUT_INFO_ARGS the total number of values they
+// reference. With CZMUT_THREADS, each thread has its own buffer.
+// Setting CZMUT_INFO_CAPACITY to 0 disables INFO and CAPTURE.
+//
+#ifndef CZMUT_INFO_CAPACITY
+	#if CZMUT_DESKTOP
+		#define CZMUT_INFO_CAPACITY 32
+	#elif CZMUT_AVR
+		#define CZMUT_INFO_CAPACITY 4
+	#else
+		#define CZMUT_INFO_CAPACITY 8
+	#endif
+#endif
+
+#ifndef CZMUT_INFO_ARGS
+	#if CZMUT_DESKTOP
+		#define CZMUT_INFO_ARGS 64
+	#elif CZMUT_AVR
+		#define CZMUT_INFO_ARGS 4
+	#else
+		#define CZMUT_INFO_ARGS 16
+	#endif
+#endif
+
+//
+// If set to 1, STATIC_TEST_CASE/STATIC_CHECK/STATIC_REQUIRE become normal TEST_CASE/CHECK/REQUIRE, so the checks can
+// be stepped through with a debugger.
+//
+#ifndef CZMUT_STATIC_TESTS_AT_RUNTIME
+	#define CZMUT_STATIC_TESTS_AT_RUNTIME 0
+#endif
+
+//
+// If set to 1, the records of the STATIC_TEST_CASEs (name and tags, used to list and count them) are collected from a
+// linker section, so they only take flash. Otherwise, each one takes a small node in RAM.
+// Needs an ELF linker, which provides the section's start and end. Disabled on AVR, where the section would need a
+// custom linker script to end up in flash.
+//
+#ifndef CZMUT_STATIC_TEST_SECTION
+	#if defined(__ELF__) && defined(__GNUC__) && !CZMUT_AVR
+		#define CZMUT_STATIC_TEST_SECTION 1
+	#else
+		#define CZMUT_STATIC_TEST_SECTION 0
+	#endif
+#endif
+
+//
+// Timing baselines (see cz::mut::recordBaseline and cz::mut::compareBaseline).
+// Only available on desktop platforms, since it needs a file system.
+//
+#ifndef CZMUT_BASELINES
+	#define CZMUT_BASELINES CZMUT_DESKTOP
+#endif
+
+//
+// Record mode for CHECK_DIGEST (see cz::mut::setDigestRecording).
+// Only available on desktop platforms, since it rewrites the source files.
+//
+#ifndef CZMUT_DIGEST_RECORDING
+	#define CZMUT_DIGEST_RECORDING CZMUT_DESKTOP
+#endif
+
+//
+// Listener support (see cz::mut::Listener). When enabled, each event costs a check for registered listeners.
+// Setting it to 0 removes the hooks completely.
+//
+#ifndef CZMUT_LISTENERS
+	#define CZMUT_LISTENERS 1
+#endif
+
+//
+// Size of the line buffer used by cz::mut::pollCommands. Longer lines are discarded.
+//
+#ifndef CZMUT_COMMAND_BUFFER_SIZE
+	#if CZMUT_AVR
+		#define CZMUT_COMMAND_BUFFER_SIZE 64
+	#else
+		#define CZMUT_COMMAND_BUFFER_SIZE 256
+	#endif
+#endif
+
+//
+// Crash isolation (see cz::mut::runIsolated).
+// Only available on POSIX desktop platforms, since it needs fork. It also needs the listeners.
+//
+#ifndef CZMUT_ISOLATION
+	#if CZMUT_DESKTOP && CZMUT_LISTENERS && (defined(__unix__) || defined(__APPLE__))
+		#define CZMUT_ISOLATION 1
+	#else
+		#define CZMUT_ISOLATION 0
+	#endif
+#endif
+
+//
+// C++20 coroutine support for async tests (see COROUTINE_TEST_CASE)
+//
+#ifndef CZMUT_COROUTINES
+	#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+		#define CZMUT_COROUTINES 1
+	#else
+		#define CZMUT_COROUTINES 0
+	#endif
+#endif
+
+#if CZMUT_COROUTINES
+	#include <coroutine>
+#endif
+
+//
+// If set to 1, the library provides a libFuzzer driver (LLVMFuzzerTestOneInput) that feeds the fuzzer's inputs to a
+// FUZZ_TEST, and any failed assertion aborts so the fuzzer stops and saves the input.
+// This needs to be set for the library's build too (e.g: with clang, -fsanitize=fuzzer -DCZMUT_FUZZ=1), and the
+// program must not have a main function, since libFuzzer provides one.
+//
+#ifndef CZMUT_FUZZ
+	#define CZMUT_FUZZ 0
+#endif
+
+#if CZMUT_DESKTOP && __has_include(<memory_resource>)
+	#define CZMUT_HAS_PMR 1
+	#include <memory_resource>
+#else
+	#define CZMUT_HAS_PMR 0
+#endif
+
+//
+// Verbosity levels. Each level includes the output of the levels below it.
+// - QUIET : Only the final results
+// - FAILURES : Failed assertions and arena leaks
+// - NORMAL : A line per test entry, and a line per runRepeat iteration
+// - VERBOSE : Extra information, such as TestArena peak usage
+//
+#define CZMUT_VERBOSITY_QUIET 0
+#define CZMUT_VERBOSITY_FAILURES 1
+#define CZMUT_VERBOSITY_NORMAL 2
+#define CZMUT_VERBOSITY_VERBOSE 3
+
+//
+// Highest verbosity level compiled in. Any output above this level (and the strings it uses) is removed from the
+// binary, regardless of what is set with cz::mut::setVerbosity.
+// This only affects mut.cpp, so it needs to be set for the library's build.
+//
+#ifndef CZMUT_COMPILE_TIME_VERBOSITY
+	#define CZMUT_COMPILE_TIME_VERBOSITY CZMUT_VERBOSITY_VERBOSE
+#endif
+
+// Verbosity level to use until cz::mut::setVerbosity is called
+#ifndef CZMUT_DEFAULT_VERBOSITY
+	#define CZMUT_DEFAULT_VERBOSITY CZMUT_VERBOSITY_NORMAL
+#endif
+
+namespace cz::mut::detail
+{
+	// Used to select our own placement new, so we don't depend on <new>, which is not available on all platforms
+	struct PlacementTag {};
+}
+
+inline void* operator new(size_t, cz::mut::detail::PlacementTag, void* ptr) noexcept
+{
+	return ptr;
+}
+
+inline void operator delete(void*, cz::mut::detail::PlacementTag, void*) noexcept
+{
+}
+
+namespace cz::mut::detail
+{
+	class TestCase;
+}
+
+namespace cz::mut
+{
+	/*
+	* A list of tests that can be run on its own (e.g: the tests of a library).
+	* Tests are added to the registry selected by CZMUT_REGISTRY when they are compiled. The default one is
+	* cz::mut::registries::global.
+	* Registries are defined with CZMUT_DEFINE_REGISTRY, and don't need a constructor to run, so tests in other
+	* translation units can be added to them in any order.
+	*/
+	class Registry
+	{
+	public:
+		constexpr Registry() = default;
+		Registry(const Registry&) = delete;
+		Registry& operator=(const Registry&) = delete;
+
+		int getCount() const
+		{
+			return m_count;
+		}
+
+	private:
+		friend class detail::TestCase;
+		detail::TestCase* m_first = nullptr;
+		detail::TestCase* m_last = nullptr;
+		int m_count = 0;
+	};
+
+	namespace registries
+	{
+		extern Registry global;
+	}
+
+	/*
+	* Selects the registry used by the runners (run, begin, runRepeat, pollCommands, etc). The default is
+	* cz::mut::registries::global.
+	*/
+	void setRegistry(Registry& registry);
+	Registry& getRegistry();
+
+	/*
+	* Same as run/begin below, but for the specified registry. It's only selected while the run is in progress, and the
+	* previous selection is restored once the run finishes.
+	*/
+	bool run(Registry& registry, const __FlashStringHelper* tags = nullptr);
+	bool begin(Registry& registry, const __FlashStringHelper* tags = nullptr);
+
+	/*
+	* Run tests
+	* \param tags
+	* This allows filtering what tests to run. If empty or null, all test will run. Check the documentation for more details
+	*/
+	bool run(const __FlashStringHelper* tags = nullptr);
+
+	/*
+	* Runs only the specified section path of a test
+	* \param tags
+	*	Same as above.
+	* \param sectionPath
+	*	'/' separated path, where the first element is the test name and the rest are section names.
+	*	E.g: "My test/section C/section C.2".
+	*	Sections not in the path are skipped without being executed. If the path stops at a section with child sections,
+	*	all those child sections are executed.
+	*/
+	bool run(const __FlashStringHelper* tags, const __FlashStringHelper* sectionPath);
+
+	/*
+	* Runs the tests repeatedly, with a full reset of the tests and sections state between iterations.
+	* Useful for soak tests (e.g: to find intermittent timing bugs or heap fragmentation), or to warm up caches.
+	* Timings and failures are aggregated and logged at the end.
+	*
+	* \param tags
+	*	Same as for "run"
+	* \param count
+	*	Maximum number of iterations. 0 means no limit.
+	* \param durationMs
+	*	No new iterations are started once this time elapses. 0 means no limit.
+	*	"count" and "durationMs" can't both be 0.
+	* \param stopOnFailure
+	*	If true, it stops after the first iteration that fails.
+	* \return
+	*	true if all iterations passed
+	*/
+	bool runRepeat(const __FlashStringHelper* tags, unsigned long count, unsigned long durationMs = 0, bool stopOnFailure = false);
+
+	/*
+	* Incremental runner, to run tests without blocking (e.g: from Arduino's loop(), alongside other code).
+	* begin selects the tests to run (same as with run), and each call to step does at most one pass through a test
+	* (or one poll of the running async tests) and returns.
+	* step returns false once everything is done and the final results were logged.
+	*
+	* begin returns false if no tests were selected.
+	*/
+	bool begin(const __FlashStringHelper* tags = nullptr);
+	bool step();
+
+	// Returns true if there is no run in progress (e.g: begin was not called yet, or step already returned false)
+	bool isDone();
+
+	/*
+	* Command driven runner, so a single image can do any number of different runs, driven by a person or a host script.
+	* Reads commands from CZMUT_SERIAL (stdin on desktop platforms), one per line. Send "help" for the list.
+	* Each call does at most one step of a run started by a command (as with cz::mut::step), or reads the available
+	* input. It only blocks on desktop platforms, while waiting for input.
+	* "READY" is logged when it's ready for the next command.
+	* Returns false once the input ends, or after a "quit" command.
+	*/
+	bool pollCommands();
+
+	struct Summary
+	{
+		int testsRan;
+		int testsSkipped;
+		int testsFailed;
+		int assertions;
+		int assertionsFailed;
+
+		bool passed() const
+		{
+			return assertionsFailed == 0;
+		}
+	};
+
+	/*
+	* Results of the current or last run
+	*/
+	Summary getSummary();
+
+	/*
+	* Resets the state of all tests and sections, so tests can run again from scratch.
+	* This is done automatically by the run functions.
+	*/
+	void reset();
+
+	enum class Verbosity : uint8_t
+	{
+		Quiet = CZMUT_VERBOSITY_QUIET,
+		Failures = CZMUT_VERBOSITY_FAILURES,
+		Normal = CZMUT_VERBOSITY_NORMAL,
+		Verbose = CZMUT_VERBOSITY_VERBOSE
+	};
+
+	/*
+	* Sets how much the run functions log.
+	* Levels above CZMUT_COMPILE_TIME_VERBOSITY are not compiled in, so behave like CZMUT_COMPILE_TIME_VERBOSITY.
+	*/
+	void setVerbosity(Verbosity verbosity);
+	Verbosity getVerbosity();
+
+	/*
+	* Milliseconds and microseconds since some unspecified point in time.
+	* Only useful to calculate elapsed times. Note that on some platforms (e.g: Arduino), these wrap around.
+	*/
+	unsigned long getMillis();
+	unsigned long getMicros();
+
+	/*
+	* Simulates an event source (e.g: a timer, an interrupt or a DMA completion), to test async code on the host.
+	*/
+	class SimulatedEvent
+	{
+	public:
+		// Fires straight away
+		void fire()
+		{
+			m_mode = Mode::Fired;
+		}
+
+		// Fires once isSet has been called the specified number of times. Useful for deterministic tests
+		void fireAfterPolls(unsigned int polls)
+		{
+			m_mode = Mode::Polls;
+			m_count = polls;
+		}
+
+		// Fires once the specified number of milliseconds has passed
+		void fireAfterMs(unsigned long ms)
+		{
+			m_mode = Mode::Time;
+			m_count = ms;
+			m_startMs = getMillis();
+		}
+
+		void clear()
+		{
+			m_mode = Mode::Idle;
+		}
+
+		bool isSet()
+		{
+			if (m_mode == Mode::Polls)
+			{
+				if (m_count == 0 || --m_count == 0)
+				{
+					m_mode = Mode::Fired;
+				}
+			}
+			else if (m_mode == Mode::Time && (getMillis() - m_startMs) >= m_count)
+			{
+				m_mode = Mode::Fired;
+			}
+
+			return m_mode == Mode::Fired;
+		}
+
+	private:
+		enum class Mode : unsigned char
+		{
+			Idle,
+			Polls,
+			Time,
+			Fired
+		};
+
+		Mode m_mode = Mode::Idle;
+		unsigned long m_count = 0;
+		unsigned long m_startMs = 0;
+	};
+
+#if CZMUT_BASELINES
+	struct BaselineOptions
+	{
+		// How many times the tests run. The median time of each pass is used for the comparisons
+		int samples = 5;
+		// Runs before the samples are collected, to warm up caches
+		int warmup = 1;
+		// A pass is a regression if it's slower than in the baseline by more than this ratio (e.g: 0.1 is 10%) ...
+		double threshold = 0.1;
+		// ... AND by more than this many median absolute deviations (the biggest of the baseline's and the current run's) ...
+		double noiseFactor = 3;
+		// ... AND by more than this many nanoseconds
+		double minDifferenceNs = 1000;
+	};
+
+	/*
+	* Runs the tests selected by the tag expression several times, timing each pass through the tests, and writes the
+	* results to the specified file.
+	* Passes are keyed by test name, type name (for templated tests) and section path.
+	* Returns false if the tests failed or the file can't be written.
+	*/
+	bool recordBaseline(const char* tags, const char* file, const BaselineOptions& options = BaselineOptions());
+
+	/*
+	* Same as recordBaseline, but instead of writing the results, compares them against a file previously written by
+	* recordBaseline.
+	* Returns false if the tests failed, the file can't be read, or any pass is slower than in the baseline (see
+	* BaselineOptions).
+	*/
+	bool compareBaseline(const char* tags, const char* file, const BaselineOptions& options = BaselineOptions());
+#endif
+
+	/*
+	* CRC32, as used by zlib, PNG, etc.
+	* To calculate it in chunks, pass the result of the previous chunk as "crc".
+	*/
+	uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+	/*
+	* Calculates the digest used by CHECK_DIGEST_STREAM as the data is produced, so the whole output never needs to be in
+	* memory at once.
+	*/
+	class Digest
+	{
+	public:
+		void update(const void* data, size_t size)
+		{
+			m_value = crc32(data, size, m_value);
+		}
+
+		void reset()
+		{
+			m_value = 0;
+		}
+
+		uint32_t value() const
+		{
+			return m_value;
+		}
+
+	private:
+		uint32_t m_value = 0;
+	};
+
+#if CZMUT_DIGEST_RECORDING
+	/*
+	* When enabled, a CHECK_DIGEST/CHECK_DIGEST_STREAM that doesn't match replaces the expected value in the source file
+	* with the calculated one, instead of failing. The new values take effect once the tests are rebuilt.
+	* Can also be enabled by setting the environment variable CZMUT_RECORD_DIGESTS to 1.
+	*/
+	void setDigestRecording(bool enabled);
+#endif
+
+#if CZMUT_THREADS
+	struct StressOptions
+	{
+		// Iterations each thread runs between barriers. All threads start each round at the same time, so they collide
+		// more than they would otherwise
+		unsigned long roundSize = 64;
+		// If not 0, the start of each iteration and each stressYield() yields the thread with a chance of 1 in yieldChance
+		unsigned int yieldChance = 8;
+		// Seed for the random yields. Each thread gets a different sequence
+		uint32_t seed = 1;
+		// Stops at the end of the first round with failed assertions
+		bool stopOnFailure = true;
+	};
+
+	struct StressResult
+	{
+		// Total, across all threads
+		unsigned long long iterations;
+		unsigned long long durationNs;
+		int assertionsFailed;
+
+		double iterationsPerSecond() const
+		{
+			return durationNs ? static_cast<double>(iterations) * 1e9 / static_cast<double>(durationNs) : 0;
+		}
+
+		bool passed() const
+		{
+			return assertionsFailed == 0;
+		}
+	};
+
+	namespace detail
+	{
+		using StressFunction = void (*)(const void* func, int thread, unsigned long iteration);
+		StressResult stress(int threads, unsigned long iterations, const StressOptions& options, StressFunction stressFunc, const void* func);
+	}
+
+	/*
+	* Hammers the code under test from several threads at once, to find races.
+	* Calls func(int thread, unsigned long iteration) "iterations" times from each of "threads" threads (0 to use as
+	* many threads as the hardware supports), in rounds that start behind a barrier (see StressOptions).
+	* Assertions that fail in the threads fail the current test as usual. Logs the throughput, so it can also be used to
+	* measure how the code scales with the number of threads.
+	*/
+	template<typename Func>
+	StressResult stress(int threads, unsigned long iterations, const Func& func, const StressOptions& options = StressOptions())
+	{
+		return detail::stress(threads, iterations, options,
+			[](const void* f, int thread, unsigned long iteration) { (*static_cast<const Func*>(f))(thread, iteration); },
+			&func);
+	}
+
+	/*
+	* A point where a thread running in cz::mut::stress can be switched out, to try more interleavings.
+	* Place these in the code under test between operations that should be atomic. Does nothing outside cz::mut::stress.
+	*/
+	void stressYield();
+#endif
+
+	/*
+	* Latency histogram, with log-linear buckets as in HdrHistogram, so it takes a fixed amount of memory and each
+	* recorded value costs a few shifts.
+	* Values are in microseconds (as given by getMicros), but nothing stops it from being used with other units.
+	* Use LatencyHistogram for the storage. This only has the logic, so it doesn't get duplicated for every size.
+	*/
+	class LatencyHistogramBase
+	{
+	public:
+		void record(unsigned long value);
+		void reset();
+
+		/*
+		* Returns the value at the specified percentile (0 to 100), rounded up to the end of its bucket, or the maximum
+		* recorded value if that is smaller. Returns 0 if nothing was recorded.
+		*/
+		unsigned long valueAtPercentile(double percentile) const;
+
+		unsigned long getCount() const
+		{
+			return m_count;
+		}
+
+		unsigned long getMin() const
+		{
+			return m_count ? m_min : 0;
+		}
+
+		unsigned long getMax() const
+		{
+			return m_max;
+		}
+
+		// Logs the count, min, p50, p99, p99.9 and max
+		void log(const __FlashStringHelper* name) const;
+
+	protected:
+		LatencyHistogramBase(uint32_t* buckets, int subBucketBits, int valueBits)
+			: m_buckets(buckets)
+			, m_subBucketBits(static_cast<uint8_t>(subBucketBits))
+			, m_valueBits(static_cast<uint8_t>(valueBits))
+		{
+			reset();
+		}
+
+		// The derived class owns the buckets, so copying would leave the copy pointing to the original's buckets
+		LatencyHistogramBase(const LatencyHistogramBase&) = delete;
+		LatencyHistogramBase& operator=(const LatencyHistogramBase&) = delete;
+
+	private:
+		int bucketIndex(unsigned long value) const;
+		unsigned long bucketHighestValue(int index) const;
+		int numBuckets() const;
+
+		uint32_t* m_buckets;
+		uint8_t m_subBucketBits;
+		uint8_t m_valueBits;
+		unsigned long m_count;
+		unsigned long m_min;
+		unsigned long m_max;
+	};
+
+	/*
+	* SubBucketBits sets the precision: Each power of two range is split into 2^SubBucketBits buckets, so values are
+	* recorded with an error of at most 1/2^SubBucketBits (12.5% with the default).
+	* ValueBits sets the highest value with its own bucket (2^ValueBits - 1). Bigger values go to the last bucket, but
+	* still count for getMax. The default covers about 1 second in microseconds.
+	* It takes (ValueBits - SubBucketBits + 1) * 2^SubBucketBits * 4 bytes (576 bytes with the defaults). For AVR,
+	* something like LatencyHistogram<2, 16> (240 bytes) is more appropriate.
+	*/
+	template<int SubBucketBits = 3, int ValueBits = 20>
+	class LatencyHistogram : public LatencyHistogramBase
+	{
+		static_assert(SubBucketBits >= 1 && SubBucketBits < ValueBits && ValueBits <= 32, "Invalid histogram size");
+
+	public:
+		LatencyHistogram()
+			: LatencyHistogramBase(m_storage, SubBucketBits, ValueBits)
+		{
+		}
+
+	private:
+		uint32_t m_storage[(ValueBits - SubBucketBits + 1) << SubBucketBits];
+	};
+
+	/*
+	* Records the time from construction to destruction in a histogram
+	*/
+	class ScopedLatency
+	{
+	public:
+		explicit ScopedLatency(LatencyHistogramBase& histogram)
+			: m_histogram(histogram)
+			, m_start(getMicros())
+		{
+		}
+
+		~ScopedLatency()
+		{
+			m_histogram.record(getMicros() - m_start);
+		}
+
+		ScopedLatency(const ScopedLatency&) = delete;
+		ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+	private:
+		LatencyHistogramBase& m_histogram;
+		unsigned long m_start;
+	};
+
+#if CZMUT_LISTENERS
+	namespace detail
+	{
+		class TestCase;
+		class Section;
+		struct ListenerAccess;
+	}
+
+	/*
+	* Receives the events of a run. Derive from this, override the events you need, and register it with addListener.
+	* Listeners are called in the order they were added.
+	*/
+	class Listener
+	{
+	public:
+		// Before the first entry of a test, and after its last entry. A templated test has one entry per type.
+		virtual void onTestStart(const detail::TestCase& /*test*/) {}
+		virtual void onTestEnd(const detail::TestCase& /*test*/) {}
+
+		// typeName is the type of the entry for templated tests, or nullptr
+		virtual void onEntryStart(const detail::TestCase& /*test*/, const __FlashStringHelper* /*typeName*/) {}
+		virtual void onEntryEnd(const detail::TestCase& /*test*/, const __FlashStringHelper* /*typeName*/) {}
+
+		// Called when a section executes, and when it exits. Sections skipped in a pass don't trigger events.
+		// The root section (with no parent) is a pass through the test.
+		virtual void onSectionEnter(const detail::Section& /*section*/) {}
+		virtual void onSectionExit(const detail::Section& /*section*/) {}
+
+		// Called for every CHECK/REQUIRE. With CZMUT_THREADS, it can be called from the test's threads too.
+		virtual void onAssertion(const __FlashStringHelper* /*file*/, int /*line*/, const __FlashStringHelper* /*expr*/, bool /*passed*/) {}
+
+	protected:
+		~Listener() = default;
+
+	private:
+		friend void addListener(Listener& listener);
+		friend void removeListener(Listener& listener);
+		friend struct detail::ListenerAccess;
+		Listener* m_nextListener = nullptr;
+	};
+
+	/*
+	* Registers/unregisters a listener. Not to be called while tests are running.
+	*/
+	void addListener(Listener& listener);
+	void removeListener(Listener& listener);
+
+	#if CZMUT_DESKTOP
+	/*
+	* Writes a Chrome/Perfetto trace (JSON, viewable with chrome://tracing or https://ui.perfetto.dev) of everything that
+	* runs while it's alive: tests, entries, each pass through the sections, and failed assertions.
+	*/
+	class ChromeTraceListener final : public Listener
+	{
+	public:
+		// Opens the file and registers itself as a listener
+		explicit ChromeTraceListener(const char* file);
+		// Unregisters itself and finishes the file
+		~ChromeTraceListener();
+
+		ChromeTraceListener(const ChromeTraceListener&) = delete;
+		ChromeTraceListener& operator=(const ChromeTraceListener&) = delete;
+
+		// Returns false if the file couldn't be opened
+		bool isOpen() const
+		{
+			return m_file != nullptr;
+		}
+
+		void onTestStart(const detail::TestCase& test) override;
+		void onTestEnd(const detail::TestCase& test) override;
+		void onEntryStart(const detail::TestCase& test, const __FlashStringHelper* typeName) override;
+		void onEntryEnd(const detail::TestCase& test, const __FlashStringHelper* typeName) override;
+		void onSectionEnter(const detail::Section& section) override;
+		void onSectionExit(const detail::Section& section) override;
+		void onAssertion(const __FlashStringHelper* file, int line, const __FlashStringHelper* expr, bool passed) override;
+
+	private:
+		// Writes everything up to (and not including) the event's name
+		void beginEvent(char phase, const char* category);
+		// If typeName is set, the event's name is "name<typeName>". asyncId is only used for async events
+		void writeEvent(char phase, const char* category, const char* name, const char* typeName = nullptr, const void* asyncId = nullptr);
+
+		FILE* m_file;
+		long long m_startNs;
+		bool m_firstEvent = true;
+	};
+	#endif
+#endif
+
+#if CZMUT_ISOLATION
+	struct IsolationOptions
+	{
+		// Test entries run by each child process. Bigger batches fork less, but a crash means running more entries again
+		int batchSize = 16;
+	};
+
+	/*
+	* Same as run, but runs the tests in batches, each in a child process, so a test that crashes (e.g: segfault, abort,
+	* failed REQUIRE) is reported as a failure, with the signal and the section it was in, and the run continues.
+	* If a batch crashes, the entries that didn't finish are split again, so the culprit runs on its own.
+	* Returns true if all tests passed.
+	*/
+	bool runIsolated(const char* tags = nullptr, const IsolationOptions& options = IsolationOptions());
+#endif
+}
+
+namespace cz::mut::detail
+{
+	void debugbreak();
+
+	void logStr(const char* str);
+#if defined(ARDUINO)
+	void logStr(const __FlashStringHelper* str);
+#endif
+	void flushlog();
+
+#if defined(ARDUINO)
+	void log(const __FlashStringHelper* str);
+#endif
+	void log(const char* str);
+	void log(char val);
+	void log(int val);
+	void log(unsigned int val);
+	void log(long val);
+	void log(unsigned long val);
+	void log(long long val);
+	void log(unsigned long long val);
+	void log(double val);
+	void log(const void* val);
+
+	//
+	// A single argument for the formatter.
+	// Arguments are captured by type (not by format specifier), so a mismatch between the format string and the
+	// argument can never cause undefined behaviour like it does with printf.
+	//
+	struct FmtArg
+	{
+		enum class Type : unsigned char
+		{
+			None,
+			Int,
+			UInt,
+			Float,
+			Char,
+			Str,
+			FlashStr,
+			Ptr,
+			Unsupported
+		};
+
+		FmtArg() : type(Type::None) { u = 0; }
+		FmtArg(bool v) : type(Type::UInt) { u = v ? 1 : 0; }
+		FmtArg(char v) : type(Type::Char) { c = v; }
+		FmtArg(signed char v) : type(Type::Int), size(sizeof(v)) { i = v; }
+		FmtArg(unsigned char v) : type(Type::UInt) { u = v; }
+		FmtArg(short v) : type(Type::Int), size(sizeof(v)) { i = v; }
+		FmtArg(unsigned short v) : type(Type::UInt) { u = v; }
+		FmtArg(int v) : type(Type::Int), size(sizeof(v)) { i = v; }
+		FmtArg(unsigned int v) : type(Type::UInt) { u = v; }
+		FmtArg(long v) : type(Type::Int), size(sizeof(v)) { i = v; }
+		FmtArg(unsigned long v) : type(Type::UInt) { u = v; }
+		FmtArg(long long v) : type(Type::Int), size(sizeof(v)) { i = v; }
+		FmtArg(unsigned long long v) : type(Type::UInt) { u = v; }
+		FmtArg(float v) : type(Type::Float) { f = v; }
+		FmtArg(double v) : type(Type::Float) { f = v; }
+		FmtArg(const char* v) : type(Type::Str) { s = v; }
+	#if defined(ARDUINO)
+		FmtArg(const __FlashStringHelper* v) : type(Type::FlashStr) { fs = v; }
+	#endif
+		FmtArg(const void* v) : type(Type::Ptr) { p = v; }
+
+		union
+		{
+			long long i;
+			unsigned long long u;
+			double f;
+			char c;
+			const char* s;
+			const __FlashStringHelper* fs;
+			const void* p;
+		};
+		Type type;
+		// Size in bytes of the original type (Int only), so %u and %x show the same bits printf would
+		unsigned char size = 0;
+	};
+
+	/**
+	 * Formats and logs "fmt" with the specified arguments.
+	 * The output is written to the log in small chunks, so there is no limit to the size of the output.
+	 */
+	void logFmtArgs(const __FlashStringHelper* fmt, const FmtArg* args, int count);
+
+	template<typename... Args>
+	void logFmt(const __FlashStringHelper* fmt, const Args&... args)
+	{
+		// The extra element makes sure we never declare a zero sized array
+		const FmtArg argList[] = { FmtArg(args)..., FmtArg() };
+		logFmtArgs(fmt, argList, sizeof...(Args));
+	}
+
+	/**
+	 * Same as logFmtArgs, but writes the output to "dst" instead. The output is truncated to fit, and is always null
+	 * terminated (if dstSize is not 0).
+	 * Returns the number of characters written, not counting the null terminator.
+	 */
+	int formatFmtArgs(char* dst, int dstSize, const __FlashStringHelper* fmt, const FmtArg* args, int count);
+
+	template<typename... Args>
+	int formatFmt(char* dst, int dstSize, const __FlashStringHelper* fmt, const Args&... args)
+	{
+		const FmtArg argList[] = { FmtArg(args)..., FmtArg() };
+		return formatFmtArgs(dst, dstSize, fmt, argList, sizeof...(Args));
+	}
+
+	//
+	// Compile time validation of format strings, used by CZMUT_LOG
+	//
+	template<typename T> struct FmtTypeOf { static constexpr FmtArg::Type value = FmtArg::Type::Unsupported; };
+	template<typename T> struct FmtTypeOf<const T> : FmtTypeOf<T> {};
+	template<typename T> struct FmtTypeOf<T*> { static constexpr FmtArg::Type value = FmtArg::Type::Ptr; };
+	template<> struct FmtTypeOf<char*> { static constexpr FmtArg::Type value = FmtArg::Type::Str; };
+	template<> struct FmtTypeOf<const char*> { static constexpr FmtArg::Type value = FmtArg::Type::Str; };
+	template<int N> struct FmtTypeOf<char[N]> { static constexpr FmtArg::Type value = FmtArg::Type::Str; };
+#if defined(ARDUINO)
+	template<> struct FmtTypeOf<const __FlashStringHelper*> { static constexpr FmtArg::Type value = FmtArg::Type::FlashStr; };
+#endif
+	template<> struct FmtTypeOf<bool> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<char> { static constexpr FmtArg::Type value = FmtArg::Type::Char; };
+	template<> struct FmtTypeOf<signed char> { static constexpr FmtArg::Type value = FmtArg::Type::Int; };
+	template<> struct FmtTypeOf<unsigned char> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<short> { static constexpr FmtArg::Type value = FmtArg::Type::Int; };
+	template<> struct FmtTypeOf<unsigned short> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<int> { static constexpr FmtArg::Type value = FmtArg::Type::Int; };
+	template<> struct FmtTypeOf<unsigned int> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<long> { static constexpr FmtArg::Type value = FmtArg::Type::Int; };
+	template<> struct FmtTypeOf<unsigned long> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<long long> { static constexpr FmtArg::Type value = FmtArg::Type::Int; };
+	template<> struct FmtTypeOf<unsigned long long> { static constexpr FmtArg::Type value = FmtArg::Type::UInt; };
+	template<> struct FmtTypeOf<float> { static constexpr FmtArg::Type value = FmtArg::Type::Float; };
+	template<> struct FmtTypeOf<double> { static constexpr FmtArg::Type value = FmtArg::Type::Float; };
+
+	template<typename... Args>
+	struct FmtArgTypes {};
+
+	// Only used in unevaluated contexts (decltype), to get the type of each argument
+	template<typename... Args>
+	FmtArgTypes<Args...> fmtArgTypes(const Args&...);
+
+	enum class FmtCheck
+	{
+		Ok,
+		InvalidSpecifier,
+		TooFewArguments,
+		TooManyArguments,
+		UnsupportedType,
+		TypeMismatch
+	};
+
+	constexpr bool isFmtTypeCompatible(char spec, FmtArg::Type type)
+	{
+		using Type = FmtArg::Type;
+		switch (spec)
+		{
+			case 'd': case 'i': case 'u': case 'x': case 'X':
+				return type == Type::Int || type == Type::UInt || type == Type::Char;
+			case 'c':
+				return type == Type::Char || type == Type::Int || type == Type::UInt;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+				return type == Type::Float;
+			case 's': case 'S':
+				return type == Type::Str || type == Type::FlashStr;
+			case 'p':
+				return type == Type::Ptr || type == Type::Str || type == Type::FlashStr;
+			default:
+				return false;
+		}
+	}
+
+	template<typename... Args>
+	constexpr FmtCheck checkFormat(StaticString fmt, FmtArgTypes<Args...>)
+	{
+		constexpr FmtArg::Type types[] = { FmtTypeOf<Args>::value..., FmtArg::Type::None };
+		constexpr int numArgs = sizeof...(Args);
+		for (int idx = 0; idx < numArgs; idx++)
+		{
+			if (types[idx] == FmtArg::Type::Unsupported)
+			{
+				return FmtCheck::UnsupportedType;
+			}
+		}
+
+		const char* str = fmt.begin();
+		int argIndex = 0;
+		int pos = 0;
+		while (pos < fmt.size())
+		{
+			if (str[pos++] != '%')
+			{
+				continue;
+			}
+
+			if (pos < fmt.size() && str[pos] == '%')
+			{
+				pos++;
+				continue;
+			}
+
+			// flags, width, precision and length modifiers
+			while (pos < fmt.size() && (str[pos] == '-' || str[pos] == '+' || str[pos] == ' ' || str[pos] == '0' || str[pos] == '#'))
+				pos++;
+			while (pos < fmt.size() && ((str[pos] >= '0' && str[pos] <= '9') || str[pos] == '.'))
+				pos++;
+			while (pos < fmt.size() && (str[pos] == 'h' || str[pos] == 'l' || str[pos] == 'z' || str[pos] == 'j' || str[pos] == 't' || str[pos] == 'L'))
+				pos++;
+
+			if (pos == fmt.size())
+			{
+				return FmtCheck::InvalidSpecifier;
+			}
+
+			if (argIndex == numArgs)
+			{
+				return FmtCheck::TooFewArguments;
+			}
+
+			char spec = str[pos++];
+			if (!isFmtTypeCompatible(spec, FmtArg::Type::Int) && !isFmtTypeCompatible(spec, FmtArg::Type::Float) &&
+				!isFmtTypeCompatible(spec, FmtArg::Type::Str) && !isFmtTypeCompatible(spec, FmtArg::Type::Ptr))
+			{
+				return FmtCheck::InvalidSpecifier;
+			}
+
+			if (!isFmtTypeCompatible(spec, types[argIndex]))
+			{
+				return FmtCheck::TypeMismatch;
+			}
+
+			argIndex++;
+		}
+
+		return argIndex == numArgs ? FmtCheck::Ok : FmtCheck::TooManyArguments;
+	}
+
+#if CZMUT_INFO_CAPACITY
+	/**
+	 * Records an INFO/CAPTURE without formatting it. Returns the position to pass to infoPop.
+	 * For a CAPTURE, fmt is the captured expression.
+	 */
+	unsigned int infoPush(const __FlashStringHelper* fmt, bool isCapture, const FmtArg* args, int count, unsigned int& argsPos);
+
+	/**
+	 * Removes the entry at the specified position, and anything pushed after it
+	 */
+	void infoPop(unsigned int pos, unsigned int argsPos);
 
-namespace cz::mut
-{
-	/*
-	* Run tests
-	* \param tags
-	* This allows filtering what tests to run. If empty or null, all test will run. Check the documentation for more details
-	*/
-	bool run(const __FlashStringHelper* tags = nullptr);
-}
+	/**
+	 * Logs the INFO/CAPTURE context currently in scope
+	 */
+	void logInfo();
 
-namespace cz::mut::detail
-{
-	void debugbreak();
+	// Keeps an INFO/CAPTURE in the context until the end of the scope
+	class ScopedInfo
+	{
+	public:
+		template<typename... Args>
+		ScopedInfo(const __FlashStringHelper* fmt, bool isCapture, const Args&... args)
+		{
+			// The extra element makes sure we never declare a zero sized array
+			const FmtArg argList[] = { FmtArg(args)..., FmtArg() };
+			m_pos = infoPush(fmt, isCapture, argList, sizeof...(Args), m_argsPos);
+		}
 
-	void logStr(const char* str);
-#if defined(ARDUINO)
-	void logStr(const __FlashStringHelper* str);
-#endif
-	void logFmt(const __FlashStringHelper* fmt, ...);
-	void flushlog();
+		~ScopedInfo()
+		{
+			infoPop(m_pos, m_argsPos);
+		}
 
-#if defined(ARDUINO)
-	void log(const __FlashStringHelper* str);
+		ScopedInfo(const ScopedInfo&) = delete;
+		ScopedInfo& operator=(const ScopedInfo&) = delete;
+
+	private:
+		unsigned int m_pos;
+		unsigned int m_argsPos;
+	};
 #endif
-	void log(const char* str);
-	void log(int val);
-	void log(unsigned int val);
-	void log(long val);
-	void log(unsigned long val);
 
 	void doCheck(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str);
 	void doRequire(bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str);
 
+	void doCheckLatency(const LatencyHistogramBase& histogram, double percentile, bool result, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str);
+
+	// Unlike the other checks, "file" is the full path (as given by __FILE__), so the record mode can find the source
+	void doCheckDigest(uint32_t digest, uint32_t expected, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr_str);
+
+#if CZMUT_DIGEST_RECORDING
+	bool isRecordingDigests();
+
+	/**
+	 * Replaces the "expected" literal of the CHECK_DIGEST at the specified line with "digest".
+	 * Returns false if the literal can't be found.
+	 */
+	bool recordDigest(const char* file, int line, uint32_t expected, uint32_t digest);
+#endif
+
 	// NOTE: No need for a version of logAssertionFailure that takes "const char* expr_str".
 	//	* On Arduino, we'll always use __FlashStringHelper
 	//	* On other platforms, __FlashStringHelper is "char", so no need for anything else
@@ -124,6 +1212,167 @@ namespace cz::mut::detail
 
 	void logFinalResults();
 
+	/**
+	 * Adds the assertions counted by all threads to gResults.
+	 * Assertions are counted per thread, so CHECK/REQUIRE are cheap and safe to use from any thread. The counts are
+	 * merged at the end of each test.
+	 */
+	void mergeThreadCounters();
+
+	template<int Size>
+	struct TestArenaStorage
+	{
+		alignas(CZMUT_MAX_ALIGN) static unsigned char data[Size];
+	};
+
+	template<int Size>
+	alignas(CZMUT_MAX_ALIGN) unsigned char TestArenaStorage<Size>::data[Size];
+
+	void* testArenaAllocate(unsigned char* buffer, size_t capacity, size_t size, size_t alignment);
+
+	// Called by the runner at the start of each test entry, and at the end of each pass through a test entry
+	void testArenaBeginTest();
+	void testArenaEndPass();
+	void testArenaEndTest();
+
+	// A STATIC_TEST_CASE. The strings are in flash
+	struct StaticTestInfo
+	{
+		const char* name;
+		const char* tags;
+	};
+
+#if !CZMUT_STATIC_TEST_SECTION
+	struct StaticTestNode
+	{
+		StaticTestInfo info;
+		StaticTestNode* next;
+	};
+
+	// Adds a STATIC_TEST_CASE, so it's listed and counted in the final report
+	void registerStaticTest(StaticTestNode& node);
+#endif
+
+	// Iterates the STATIC_TEST_CASEs. nextStaticTest returns nullptr after the last one
+	const StaticTestInfo* firstStaticTest();
+	const StaticTestInfo* nextStaticTest(const StaticTestInfo* test);
+	int countStaticTests();
+
+	// Time used by EQUIVALENCE_TEST. Nanoseconds on desktop platforms, microseconds elsewhere. Wraps around.
+	unsigned long getTicks();
+
+	/**
+	 * Fails a CHECK_EQUIVALENT. If the results can be logged, "values" has the reference and optimized results.
+	 */
+	void equivalenceMismatch(const __FlashStringHelper* file, int line, const __FlashStringHelper* expr, int input, const __FlashStringHelper* referenceName, const __FlashStringHelper* optimizedName, const FmtArg* values);
+
+	/**
+	 * Logs the timings of an EQUIVALENCE_TEST pass, and checks the speedup if minSpeedup is not 0
+	 */
+	void finishEquivalence(const __FlashStringHelper* file, int line, int count, unsigned long long referenceTicks, unsigned long long optimizedTicks, double minSpeedup);
+
+	/**
+	 * Feeds the inputs of an EQUIVALENCE_TEST to both implementations, and times them
+	 */
+	template<typename ReferenceFunc, typename OptimizedFunc>
+	class Equivalence
+	{
+	public:
+		Equivalence(ReferenceFunc reference, OptimizedFunc optimized, const __FlashStringHelper* referenceName, const __FlashStringHelper* optimizedName)
+			: m_reference(reference)
+			, m_optimized(optimized)
+			, m_referenceName(referenceName)
+			, m_optimizedName(optimizedName)
+		{
+		}
+
+		// "expr" is the CHECK_EQUIVALENT call, for listeners and failure reports
+		template<typename... Args>
+		void check(const __FlashStringHelper* file, int line, const __FlashStringHelper* expr, const Args&... args)
+		{
+			m_count++;
+			// Alternating which one runs first, so neither always gets a cold cache
+			if (m_count & 1)
+			{
+				auto expected = timeCall(m_reference, m_referenceTicks, args...);
+				auto actual = timeCall(m_optimized, m_optimizedTicks, args...);
+				compare(expected, actual, file, line, expr);
+			}
+			else
+			{
+				auto actual = timeCall(m_optimized, m_optimizedTicks, args...);
+				auto expected = timeCall(m_reference, m_referenceTicks, args...);
+				compare(expected, actual, file, line, expr);
+			}
+		}
+
+		void finish(const __FlashStringHelper* file, int line, double minSpeedup)
+		{
+			finishEquivalence(file, line, m_count, m_referenceTicks, m_optimizedTicks, minSpeedup);
+		}
+
+	private:
+		template<typename Func, typename... Args>
+		static auto timeCall(Func& func, unsigned long long& total, const Args&... args)
+		{
+			unsigned long start = getTicks();
+			auto res = func(args...);
+			total += getTicks() - start;
+			return res;
+		}
+
+		template<typename E, typename A>
+		void compare(const E& expected, const A& actual, const __FlashStringHelper* file, int line, const __FlashStringHelper* expr)
+		{
+			if (expected == actual)
+			{
+				doCheck(true, file, line, expr);
+			}
+			else if constexpr (FmtTypeOf<E>::value != FmtArg::Type::Unsupported && FmtTypeOf<A>::value != FmtArg::Type::Unsupported)
+			{
+				const FmtArg values[] = { FmtArg(expected), FmtArg(actual) };
+				equivalenceMismatch(file, line, expr, m_count, m_referenceName, m_optimizedName, values);
+			}
+			else
+			{
+				equivalenceMismatch(file, line, expr, m_count, m_referenceName, m_optimizedName, nullptr);
+			}
+		}
+
+		ReferenceFunc m_reference;
+		OptimizedFunc m_optimized;
+		const __FlashStringHelper* m_referenceName;
+		const __FlashStringHelper* m_optimizedName;
+		int m_count = 0;
+		unsigned long long m_referenceTicks = 0;
+		unsigned long long m_optimizedTicks = 0;
+	};
+
+#if CZMUT_BASELINES
+	class TestCase;
+	class Section;
+	// If set, the runner calls this after every pass through a test, with the pass's deepest section and duration
+	using PassTimingHook = void(*)(const TestCase* test, const __FlashStringHelper* typeName, const Section* leaf, uint64_t durationNs);
+	extern PassTimingHook gPassTimingHook;
+#endif
+
+#if CZMUT_ISOLATION
+	// Set in the child processes of runIsolated, so the runner only runs the entries in [firstEntry, lastEntry), counted
+	// across the enabled tests, and doesn't log the final results
+	struct IsolatedBatch
+	{
+		bool active;
+		int firstEntry;
+		int lastEntry;
+	};
+	extern IsolatedBatch gIsolatedBatch;
+	struct IsolationAccess;
+
+	// Unregisters all listeners without notifying them. Used in the child processes of runIsolated, so the listeners
+	// inherited from the parent (e.g: a trace file) don't get the child's events
+	void detachListeners();
+#endif
+
 	//
 	// Helper to make it easier to manipulate strings in flash memory
 	// 
@@ -135,6 +1384,21 @@ namespace cz::mut::detail
 		{
 		}
 
+		/**
+		 * Iterates a string in RAM instead (e.g: a command received over serial).
+		 * Only AVR needs to know the difference. Everywhere else, flash is readable as any other memory.
+		 */
+		static FlashStringIterator fromRam(const char* str)
+		{
+		#if CZMUT_AVR
+			FlashStringIterator it(str);
+			it.m_ram = true;
+			return it;
+		#else
+			return FlashStringIterator(reinterpret_cast<const __FlashStringHelper*>(str));
+		#endif
+		}
+
 		inline FlashStringIterator& operator++()
 		{
 			m_pos++;
@@ -166,10 +1430,10 @@ namespace cz::mut::detail
 		inline bool operator==(const FlashStringIterator& other) const { return m_pos == other.m_pos; }
 		inline bool operator!=(const FlashStringIterator& other) const { return m_pos != other.m_pos; }
 		inline int operator-(const FlashStringIterator& other) const { return m_pos - other.m_pos; }
-		inline FlashStringIterator operator+(int val) const { return FlashStringIterator(m_pos+val); }
-		inline FlashStringIterator operator-(int val) const { return FlashStringIterator(m_pos-val); }
-		inline FlashStringIterator operator+(size_t val) const { return FlashStringIterator(m_pos+val); }
-		inline FlashStringIterator operator-(size_t val) const { return FlashStringIterator(m_pos-val); }
+		inline FlashStringIterator operator+(int val) const { FlashStringIterator it(*this); it.m_pos += val; return it; }
+		inline FlashStringIterator operator-(int val) const { FlashStringIterator it(*this); it.m_pos -= val; return it; }
+		inline FlashStringIterator operator+(size_t val) const { FlashStringIterator it(*this); it.m_pos += val; return it; }
+		inline FlashStringIterator operator-(size_t val) const { FlashStringIterator it(*this); it.m_pos -= val; return it; }
 		inline const char* c_str() const { return m_pos; }
 		inline const __FlashStringHelper* data() const { return reinterpret_cast<const __FlashStringHelper*>(m_pos); }
 		explicit inline operator bool() const { return m_pos ? true : false; }
@@ -184,8 +1448,22 @@ namespace cz::mut::detail
 		}
 	#endif
 		const char* m_pos;
+	#if CZMUT_AVR
+		bool m_ram = false;
+	#endif
 	};
 
+	/**
+	 * Same as cz::mut::begin and cz::mut::runRepeat, but the tag expression can be in RAM (see
+	 * FlashStringIterator::fromRam)
+	 */
+	bool beginRun(FlashStringIterator tags);
+	bool runRepeat(FlashStringIterator tags, unsigned long count, unsigned long durationMs, bool stopOnFailure);
+
+	// Enables the tests selected by the tag expression, without starting a run. Logs a failure and returns false if
+	// the expression is malformed or selects no tests
+	bool selectTests(FlashStringIterator tags);
+
 	//
 	// Allows indexing an initializer list, and counting elements
 	template<class T>
@@ -215,12 +1493,48 @@ namespace cz::mut::detail
 
 		static Section* getActive();
 		const __FlashStringHelper* getName() const;
+		const Section* getParent() const
+		{
+			return m_parent;
+		}
+
+		/**
+		 * Last section executed. At the end of a pass through a test, this is the pass's deepest section.
+		 */
+		static const Section* getLastExecuted()
+		{
+			return ms_lastExecuted;
+		}
+
 		bool tryExecute();
 		void start();
 		void end();
 
+		/**
+		 * Sets a '/' separated path of section names, so only sections in that path are executed.
+		 * The root section is not part of the path. Set to nullptr to execute all sections.
+		 */
+		static void setFilterPath(const __FlashStringHelper* path);
+
+		/**
+		 * Resets all the sections that were ever executed, so they can be executed again from scratch
+		 */
+		static void resetAll();
+
+		/**
+		 * Returns true if a section matching the full filter path was executed
+		 */
+		static bool hasMatchedFilterPath();
+
 	private:
 
+		/**
+		 * Checks if this section is part of the filter path.
+		 * If the section is deeper than the filter path, then it's considered as matching (as-in, it's a child of the last
+		 * section in the path).
+		 */
+		bool matchesFilterPath();
+
 		enum class State : unsigned char
 		{
 			Uninitialized,
@@ -231,10 +1545,17 @@ namespace cz::mut::detail
 
 		void onChildStart();
 		void onChildEnd(State childState);
+		void reset();
 
 		const __FlashStringHelper* m_name;
 		Section* m_parent = nullptr;
-		static Section* ms_active;
+		// All the sections that were ever started are kept in a list, so they can be reset
+		Section* m_nextStarted = nullptr;
+		static Section* ms_firstStarted;
+		static Section* ms_lastExecuted;
+		static CZMUT_ATOMIC(Section*) ms_active;
+		static const __FlashStringHelper* ms_filterPath;
+		static bool ms_filterPathMatched;
 
 		// If you get an error such as: 'cz::mut::detail::Section::m_state' is too small to hold all values of 'enum class cz::mut::detail::Section::State' ,
 		// it's because you're still on an old AVR toolchain (e.g: toolchain-atmelavr @ 1.70300.191015 (7.3.0) ).
@@ -242,6 +1563,7 @@ namespace cz::mut::detail
 		State m_state : 2;
 		bool m_childExecuted : 1;
 		bool m_hasActiveChild : 1;
+		bool m_started : 1;
 	};
 
 	class AutoSection
@@ -285,12 +1607,19 @@ namespace cz::mut::detail
 				, rootSection(F("ROOT"))
 			{
 			}
+
+			Entry(EntryFunction func, const __FlashStringHelper* typeName)
+				: func(func)
+				, rootSection(F("ROOT"))
+				, typeName(typeName)
+			{
+			}
 			EntryFunction func;
 			Section rootSection;
 			const __FlashStringHelper* typeName = nullptr;
 		};
 		
-		TestCase(const __FlashStringHelper* name, const __FlashStringHelper* tags);
+		TestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags);
 		~TestCase() ;
 		static TestCase* getActive();
 		static const __FlashStringHelper* getActiveTestType();
@@ -306,79 +1635,270 @@ namespace cz::mut::detail
 			m_failed = true;
 		}
 
-		static int countEnabledTests();
+		// Async tests run alongside other tests (see ASYNC_TEST_CASE)
+		bool isAsync() const;
+
+		static int countEnabledTests();
+
+	protected:
+		friend bool cz::mut::run(const __FlashStringHelper* tags);
+		friend bool cz::mut::run(const __FlashStringHelper* tags, const __FlashStringHelper* sectionPath);
+		// Checks the tags of a test (testTags) against a tag, or a list of tags
+		static bool hasTag(const __FlashStringHelper* testTags, detail::FlashStringIterator tagStart, detail::FlashStringIterator tagEnd);
+		static bool hasAllTags(const __FlashStringHelper* testTags, detail::FlashStringIterator tagsStart, detail::FlashStringIterator tagsEnd);
+		// Number of STATIC_TEST_CASEs the tag expression selects, for the final report
+		static int countSelectedStaticTests(detail::FlashStringIterator tags, detail::FlashStringIterator tagsEnd);
+		static bool run();
+
+		/**
+		 * Incremental runner. See cz::mut::begin and cz::mut::step
+		 */
+		static void begin();
+		static bool step();
+		static bool isRunning();
+		friend bool beginRun(FlashStringIterator tags);
+		friend bool selectTests(FlashStringIterator tags);
+		friend struct CommandAccess;
+		friend bool cz::mut::step();
+		friend bool cz::mut::isDone();
+
+		/**
+		 * Enables the tests selected by the tag expression, and disables all others.
+		 * If a name is specified, only tests with that exact name can be enabled.
+		 */
+		static bool filter(detail::FlashStringIterator tags,
+			detail::FlashStringIterator nameStart = detail::FlashStringIterator(nullptr),
+			detail::FlashStringIterator nameEnd = detail::FlashStringIterator(nullptr));
+
+		/**
+		 * Calls func(test, id) for all the tests with the specified name.
+		 * Uses the name index if available.
+		 */
+		template<typename Func>
+		static void forEachNamed(detail::FlashStringIterator nameStart, detail::FlashStringIterator nameEnd, Func&& func);
+
+		/**
+		 * Returns the test with the specified ID (1 based, in registration order), or nullptr if it doesn't exist
+		 */
+		static TestCase* findById(int id);
+
+		/**
+		 * Builds the name index if it doesn't exist or it's out of date.
+		 * Returns false if the index is not available.
+		 */
+		static bool updateNameIndex();
+
+		// Moves the incremental runner to the next test entry
+		static void nextEntry();
+
+		/**
+		 * Resets the state of all the tests, so they can run again
+		 */
+		static void resetAll();
+		friend void cz::mut::reset();
+		friend class AsyncTestCase;
+		friend class FuzzTestCase;
+#if CZMUT_ISOLATION
+		friend struct IsolationAccess;
+#endif
+
+		void setEntries(Entry* entries, unsigned char count)
+		{
+			m_entries = entries;
+			m_numEntries = count;
+		}
+
+		// This is used to control how big the list of types of a templated test case. Using a specific number of bits
+		// so we can pack things tightly and save RAM.
+		// 6 bits means a maximum value of 63. A type list of 63 types for a templated test case should be enough. :)
+		static constexpr int NumEntriesBits = 6;
+
+	private:
+
+		const __FlashStringHelper* m_name;
+		const __FlashStringHelper* m_tags;
+		TestCase* m_next;
+		Entry* m_entries;
+		unsigned char m_numEntries : NumEntriesBits;
+		bool m_enabled : 1;
+		bool m_failed : 1;
+
+		// First test of the current registry
+		static TestCase* getFirst()
+		{
+			return ms_registry->m_first;
+		}
+		friend void cz::mut::setRegistry(Registry& registry);
+		friend Registry& cz::mut::getRegistry();
+
+		// Registry the runners use
+		static Registry* ms_registry;
+		static CZMUT_ATOMIC(TestCase*) ms_active;
+		static CZMUT_ATOMIC(Entry*) ms_activeEntry;
+	};
+
+	template<bool enabled> class SingleEntryTestCase;
+
+	template<> class SingleEntryTestCase<false>
+	{
+	public:
+		using EntryFunction = void(*)();
+		SingleEntryTestCase(Registry&, const __FlashStringHelper*, const __FlashStringHelper*, EntryFunction)
+		{
+		}
+	};
+	
+	template<>
+	class SingleEntryTestCase<true> : public TestCase
+	{
+	public:
+		
+		SingleEntryTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, EntryFunction func)
+			: TestCase(registry, name, tags)
+			, m_myEntries{ func }
+		{
+			setEntries(m_myEntries, 1);
+		}
+
+	private:
+		Entry m_myEntries[1];
+	};
+
+	//
+	// State of an async test between resumes
+	//
+	struct AsyncContext
+	{
+		// Line of the ASYNC_ macro where the test resumes. 0 means the start of the test
+		int resumePoint;
+		// If set, the test is being stopped (e.g: it timed out), and should clean up and return true
+		bool cancel;
+		union
+		{
+			// Used by ASYNC_WAIT_MS
+			unsigned long timerStartMs;
+			// Used by COROUTINE_TEST_CASE
+			void* coroutine;
+		};
+	};
+
+	// Resumes an async test. Returns true once the test is finished
+	using AsyncFunction = bool(*)(AsyncContext&);
+
+	// Entry function of async tests. Allows the runner to tell async tests apart without extra RAM per test
+	void asyncEntry();
+
+	class AsyncTestCase : public TestCase
+	{
+	public:
+		AsyncTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, const __FlashStringHelper* file, AsyncFunction func, unsigned long timeoutMs);
+
+		/**
+		 * Starts the test, adding it to the list of active async tests
+		 */
+		void start();
+
+		/**
+		 * Resumes each active async test once.
+		 * Returns true if there are still active tests.
+		 */
+		static bool pollAll();
+
+		/**
+		 * Stops all the active async tests without reporting anything
+		 */
+		static void resetAll();
+
+	private:
+		// Returns true if the test finished
+		bool poll();
+
+		Entry m_myEntries[1];
+		const __FlashStringHelper* m_file;
+		AsyncFunction m_func;
+		unsigned long m_timeoutMs;
+		unsigned long m_startMs;
+		AsyncContext m_context;
+		AsyncTestCase* m_nextActive = nullptr;
+		static AsyncTestCase* ms_firstActive;
+	};
+
+	template<bool enabled> class AsyncSingleEntryTestCase;
+
+	template<> class AsyncSingleEntryTestCase<false>
+	{
+	public:
+		AsyncSingleEntryTestCase(Registry&, const __FlashStringHelper*, const __FlashStringHelper*, const __FlashStringHelper*, AsyncFunction, unsigned long)
+		{
+		}
+	};
+
+	template<> class AsyncSingleEntryTestCase<true> : public AsyncTestCase
+	{
+	public:
+		using AsyncTestCase::AsyncTestCase;
+	};
 
-	protected:
-		friend bool cz::mut::run(const __FlashStringHelper* tags);
-		bool hasTag(detail::FlashStringIterator tagStart, detail::FlashStringIterator tagEnd) const;
-		static bool run();
-		static bool filter(detail::FlashStringIterator tags);
+	//
+	// An input replayed through a FUZZ_TEST when the tests run (see FUZZ_CORPUS)
+	//
+	struct FuzzCorpusEntry
+	{
+		FuzzCorpusEntry(const __FlashStringHelper* testName, const __FlashStringHelper* name, const uint8_t* data, size_t size);
 
-		void setEntries(Entry* entries, unsigned char count)
-		{
-			m_entries = entries;
-			m_numEntries = count;
-		}
+		const __FlashStringHelper* testName;
+		const __FlashStringHelper* name;
+		// In PROGMEM
+		const uint8_t* data;
+		size_t size;
+		FuzzCorpusEntry* next;
 
-		template<typename A0>
-		void addTypeNames(int index, A0&& a)
-		{
-			m_entries[index].typeName = a;
-		}
+		static FuzzCorpusEntry* ms_first;
+		static FuzzCorpusEntry* ms_last;
+	};
 
-		template<typename A0, typename... AN>
-		void addTypeNames(int index, A0&& a, AN&&... aN)
-		{
-			m_entries[index].typeName = a;
-			addTypeNames(index+1, ministd::forward<AN>(aN)...);
-		}
+	using FuzzFunction = void(*)(const uint8_t* data, size_t size);
 
-		// This is used to control how big the list of types of a templated test case. Using a specific number of bits
-		// so we can pack things tightly and save RAM.
-		// 6 bits means a maximum value of 63. A type list of 63 types for a templated test case should be enough. :)
-		static constexpr int NumEntriesBits = 6;
+	// Entry function of fuzz tests. Replays the corpus of the active test
+	void fuzzEntry();
 
-	private:
+	class FuzzTestCase : public TestCase
+	{
+	public:
+		FuzzTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, FuzzFunction func);
 
-		const __FlashStringHelper* m_name;
-		const __FlashStringHelper* m_tags;
-		TestCase* m_next;
-		Entry* m_entries;
-		unsigned char m_numEntries : NumEntriesBits;
-		bool m_enabled : 1;
-		bool m_failed : 1;
+		/**
+		 * Calls the fuzz target with each corpus entry registered for this test
+		 */
+		void replayCorpus();
+
+	#if CZMUT_FUZZ
+		/**
+		 * Calls the fuzz target selected with the CZMUT_FUZZ_TEST environment variable (or the first one if not set)
+		 * with one input. Aborts if any assertion fails.
+		 */
+		static void fuzzOne(const uint8_t* data, size_t size);
+	#endif
 
-		static TestCase* ms_first;
-		static TestCase* ms_last;
-		static TestCase* ms_active;
-		static Entry* ms_activeEntry;
+	private:
+		Entry m_myEntries[1];
+		FuzzFunction m_func;
 	};
 
-	template<bool enabled> class SingleEntryTestCase;
+	template<bool enabled> class FuzzSingleEntryTestCase;
 
-	template<> class SingleEntryTestCase<false>
+	template<> class FuzzSingleEntryTestCase<false>
 	{
 	public:
-		using EntryFunction = void(*)();
-		SingleEntryTestCase(const __FlashStringHelper*, const __FlashStringHelper*, EntryFunction)
+		FuzzSingleEntryTestCase(Registry&, const __FlashStringHelper*, const __FlashStringHelper*, FuzzFunction)
 		{
 		}
 	};
-	
-	template<>
-	class SingleEntryTestCase<true> : public TestCase
+
+	template<> class FuzzSingleEntryTestCase<true> : public FuzzTestCase
 	{
 	public:
-		
-		SingleEntryTestCase(const __FlashStringHelper* name, const __FlashStringHelper* tags, EntryFunction func)
-			: TestCase(name, tags)
-			, m_myEntries{ func }
-		{
-			setEntries(m_myEntries, 1);
-		}
-
-	private:
-		Entry m_myEntries[1];
+		using FuzzTestCase::FuzzTestCase;
 	};
 
 	struct Results
@@ -506,6 +2026,74 @@ namespace cz::mut
 		return true;
 	}
 
+	/**
+	 * Bump allocator for test scratch memory.
+	 *
+	 * Allocations come from a fixed buffer (of CZMUT_TEST_ARENA_SIZE bytes), and the arena is automatically rewound at
+	 * the end of every pass through a test (once per leaf section), so there is no heap fragmentation and allocating is
+	 * just a pointer increment.
+	 * Any allocations not freed with "deallocate" by the end of the pass are reported as leaks. The peak usage of each
+	 * test is also logged.
+	 *
+	 * Only meant to be used from the thread running the tests.
+	 */
+	class TestArena
+	{
+	public:
+		/**
+		 * Allocates memory from the arena.
+		 * If the arena doesn't have enough space, it fails the current test and returns nullptr.
+		 */
+		static void* allocate(size_t size, size_t alignment = CZMUT_MAX_ALIGN)
+		{
+			return detail::testArenaAllocate(detail::TestArenaStorage<CZMUT_TEST_ARENA_SIZE>::data, CZMUT_TEST_ARENA_SIZE, size, alignment);
+		}
+
+		/**
+		 * Frees memory.
+		 * Memory is only really reclaimed if it's the last allocation (or when the arena is rewound), but freeing
+		 * everything allows the leak detection to work.
+		 */
+		static void deallocate(void* ptr, size_t size);
+
+		/**
+		 * Allocates and constructs an object. Destroy it with "destroy"
+		 */
+		template<typename T, typename... Args>
+		static T* create(Args&&... args)
+		{
+			void* ptr = allocate(sizeof(T), alignof(T));
+			return ptr ? new (detail::PlacementTag(), ptr) T(ministd::forward<Args>(args)...) : nullptr;
+		}
+
+		template<typename T>
+		static void destroy(T* obj)
+		{
+			if (obj)
+			{
+				obj->~T();
+				deallocate(obj, sizeof(T));
+			}
+		}
+
+		// Bytes currently in use
+		static size_t getUsed();
+
+		// Peak usage since the start of the current (or last) test
+		static size_t getPeak();
+
+		// Number of allocations not freed yet
+		static size_t getLiveAllocations();
+
+	#if CZMUT_HAS_PMR
+		/**
+		 * A std::pmr::memory_resource that allocates from the arena, so it can be used with std::pmr containers.
+		 * If the arena runs out of memory, it throws std::bad_alloc, as required by std::pmr.
+		 */
+		static std::pmr::memory_resource* getResource();
+	#endif
+	};
+
 } // cz::mut
 
 #define INTERNAL_SECTION(Description, SectionName) \
@@ -516,7 +2104,8 @@ namespace cz::mut
 	namespace { \
 		static const char CZMUT_CONCATENATE(desc_,TestFunction)[] PROGMEM = Description; \
 		static const char CZMUT_CONCATENATE(tags_,TestFunction)[] PROGMEM = Tags; \
-		TestClass<cz::mut::contains(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))> CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase) ( \
+		TestClass<cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))> CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase) ( \
+			::cz::mut::registries::CZMUT_REGISTRY, \
 			(const __FlashStringHelper*) CZMUT_CONCATENATE(desc_, TestFunction), \
 			(const __FlashStringHelper*) CZMUT_CONCATENATE(tags_, TestFunction), \
 			&TestFunction); \
@@ -527,56 +2116,387 @@ namespace cz::mut
 
 	namespace cz::mut::detail
 	{
-		template<bool enabled, typename TBaseTestClass, int NumEntries>
-		struct TemplatedTestCaseBaseClass; 
-
-		template<typename TBaseTestClass, int NumEntries>
-		struct TemplatedTestCaseBaseClass<false, TBaseTestClass, NumEntries>
+		//
+		// A test with one entry per type in the list.
+		// There is one class per type list, shared by all the tests that use the same list. What is specific to each
+		// test is the Funcs class, which gives the test function for each type.
+		//
+		template<bool enabled, typename List>
+		class TypeListTestCase;
+
+		template<typename... Types>
+		class TypeListTestCase<false, TypeList<Types...>>
 		{
-			enum { Enabled = false };
-			template<typename... FuncPtrs>
-			TemplatedTestCaseBaseClass(const __FlashStringHelper* desc, const __FlashStringHelper* tags, FuncPtrs... funcs) {}
+		public:
+			template<typename Funcs>
+			TypeListTestCase(Registry&, const __FlashStringHelper*, const __FlashStringHelper*, Funcs)
+			{
+			}
 		};
 
-		template<typename TBaseTestClass, int NumEntries>
-		struct TemplatedTestCaseBaseClass<true, TBaseTestClass, NumEntries> : public TBaseTestClass
+		template<typename... Types>
+		class TypeListTestCase<true, TypeList<Types...>> : public TestCase
 		{
-			enum { Enabled = true };
-			TestCase::Entry m_myEntries[NumEntries];
-			using EntryFunction = void(*)();
-
-			template<typename... FuncPtrs>
-			TemplatedTestCaseBaseClass(const __FlashStringHelper* desc, const __FlashStringHelper* tags, FuncPtrs... funcs)
-				: TBaseTestClass(desc, tags)
-				, m_myEntries { funcs... }
+		public:
+			template<typename Funcs>
+			TypeListTestCase(Registry& registry, const __FlashStringHelper* name, const __FlashStringHelper* tags, Funcs)
+				: TestCase(registry, name, tags)
+				, m_myEntries { {Funcs::template get<Types>(), TypeName<Types>::get()}... }
 			{
-				static_assert(NumEntries == sizeof...(FuncPtrs));
-				static_assert(NumEntries < (1<<TBaseTestClass::NumEntriesBits));
-				this->setEntries(m_myEntries, NumEntries);
+				static_assert(sizeof...(Types) > 0, "A templated test case needs at least one type");
+				static_assert(sizeof...(Types) < (1 << NumEntriesBits), "Too many types for a templated test case");
+				setEntries(m_myEntries, sizeof...(Types));
 			}
+
+		private:
+			Entry m_myEntries[sizeof...(Types)];
 		};
 	}
 
-#define INTERNAL_TEMPLATED_TEST_CASE(TestClass, BaseTestClass, Description, Tags, TestFunction, ...) \
+#define INTERNAL_TEMPLATED_TEST_CASE(Funcs, Description, Tags, TestFunction, ...) \
 	template<typename TestType> \
 	static void TestFunction(); \
 	namespace { \
-		template<typename... Type> \
-		struct TestClass : public ::cz::mut::detail::TemplatedTestCaseBaseClass<::cz::mut::contains(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS)), BaseTestClass, sizeof...(Type)> \
+		static const char CZMUT_CONCATENATE(desc_,TestFunction)[] PROGMEM = Description; \
+		static const char CZMUT_CONCATENATE(tags_,TestFunction)[] PROGMEM = Tags; \
+		struct Funcs \
 		{ \
-			using Super = ::cz::mut::detail::TemplatedTestCaseBaseClass<::cz::mut::contains(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS)), BaseTestClass, sizeof...(Type)>;\
-			TestClass() \
-				: Super(F(Description), F(Tags), (&TestFunction<Type>)...) \
+			template<typename TestType> \
+			static constexpr ::cz::mut::detail::TestCase::EntryFunction get() \
 			{ \
-				if constexpr(Super::Enabled) \
-					Super::addTypeNames(0, CZMUT_BUILD_STRING_LIST_P(__VA_ARGS__)); \
+				return &TestFunction<TestType>; \
 			} \
 		}; \
-		TestClass< __VA_ARGS__ > CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase); \
+		::cz::mut::detail::TypeListTestCase<cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS)), ::cz::mut::detail::TypeListOf<__VA_ARGS__>> CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase) ( \
+			::cz::mut::registries::CZMUT_REGISTRY, \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(desc_, TestFunction), \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(tags_, TestFunction), \
+			Funcs()); \
 	} \
 	template<typename TestType> \
 	static void TestFunction()
 
+	namespace cz::mut::detail
+	{
+		//
+		// Storage for fixtures.
+		// A template, so it only takes RAM if there is at least one fixture
+		//
+		template<int Size>
+		struct FixtureArena
+		{
+			alignas(CZMUT_FIXTURE_ARENA_ALIGN) static unsigned char data[Size];
+		};
+
+		template<int Size>
+		alignas(CZMUT_FIXTURE_ARENA_ALIGN) unsigned char FixtureArena<Size>::data[Size];
+
+		//
+		// Constructs the fixture in the arena, runs the test and destroys the fixture.
+		// This is called once per pass through the test, so each pass (one per leaf section) gets a fresh fixture.
+		//
+		template<typename TestClass>
+		void runFixtureTest()
+		{
+			static_assert(sizeof(TestClass) <= CZMUT_FIXTURE_ARENA_SIZE, "Fixture is too big for the fixture arena. Increase CZMUT_FIXTURE_ARENA_SIZE");
+			static_assert(alignof(TestClass) <= CZMUT_FIXTURE_ARENA_ALIGN, "Fixture alignment is too big for the fixture arena. Increase CZMUT_FIXTURE_ARENA_ALIGN");
+			TestClass* fixture = new (PlacementTag(), FixtureArena<CZMUT_FIXTURE_ARENA_SIZE>::data) TestClass();
+			fixture->test();
+			fixture->~TestClass();
+		}
+	}
+
+#define INTERNAL_TEST_CASE_METHOD(Fixture, Description, Tags, TestClass, TestFunction) \
+	namespace { \
+		struct TestClass : public Fixture \
+		{ \
+			void test(); \
+		}; \
+	} \
+	INTERNAL_TEST_CASE(cz::mut::detail::SingleEntryTestCase, Description, Tags, TestFunction) \
+	{ \
+		::cz::mut::detail::runFixtureTest<TestClass>(); \
+	} \
+	void TestClass::test()
+
+//
+// A static test only takes a record with its name and tags, so it can be listed and counted. The record is in flash
+// with CZMUT_STATIC_TEST_SECTION, and in RAM otherwise.
+// The body is never called. Any STATIC_CHECK in it is evaluated when the body is compiled.
+//
+#define INTERNAL_STATIC_TEST_CASE_STRINGS(Description, Tags, RegisterFunction) \
+	namespace { \
+		static const char CZMUT_CONCATENATE(desc_,RegisterFunction)[] PROGMEM = Description; \
+		static const char CZMUT_CONCATENATE(tags_,RegisterFunction)[] PROGMEM = Tags; \
+	}
+
+#if CZMUT_STATIC_TEST_SECTION
+	// The function is never called. It only exists so the record is only emitted if the test is enabled
+	#define INTERNAL_STATIC_TEST_CASE_REGISTER(Description, Tags, RegisterFunction) \
+		INTERNAL_STATIC_TEST_CASE_STRINGS(Description, Tags, RegisterFunction) \
+		__attribute__((used)) static void RegisterFunction() \
+		{ \
+			if constexpr (cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))) \
+			{ \
+				__attribute__((used, section("czmut_static_tests"))) static const ::cz::mut::detail::StaticTestInfo record = { \
+					CZMUT_CONCATENATE(desc_, RegisterFunction), CZMUT_CONCATENATE(tags_, RegisterFunction) }; \
+			} \
+		}
+#elif defined(__GNUC__)
+	#define INTERNAL_STATIC_TEST_CASE_REGISTER(Description, Tags, RegisterFunction) \
+		INTERNAL_STATIC_TEST_CASE_STRINGS(Description, Tags, RegisterFunction) \
+		__attribute__((constructor)) static void RegisterFunction() \
+		{ \
+			if constexpr (cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))) \
+			{ \
+				static ::cz::mut::detail::StaticTestNode node = { \
+					{CZMUT_CONCATENATE(desc_, RegisterFunction), CZMUT_CONCATENATE(tags_, RegisterFunction)}, nullptr }; \
+				::cz::mut::detail::registerStaticTest(node); \
+			} \
+		}
+#else
+	#define INTERNAL_STATIC_TEST_CASE_REGISTER(Description, Tags, RegisterFunction) \
+		INTERNAL_STATIC_TEST_CASE_STRINGS(Description, Tags, RegisterFunction) \
+		namespace { \
+			struct RegisterFunction \
+			{ \
+				RegisterFunction() \
+				{ \
+					if constexpr (cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))) \
+					{ \
+						static ::cz::mut::detail::StaticTestNode node = { \
+							{CZMUT_CONCATENATE(desc_, RegisterFunction), CZMUT_CONCATENATE(tags_, RegisterFunction)}, nullptr }; \
+						::cz::mut::detail::registerStaticTest(node); \
+					} \
+				} \
+			} CZMUT_CONCATENATE(RegisterFunction, _instance); \
+		}
+#endif
+
+#define INTERNAL_STATIC_TEST_CASE(Description, Tags, RegisterFunction, TestFunction) \
+	INTERNAL_STATIC_TEST_CASE_REGISTER(Description, Tags, RegisterFunction) \
+	[[maybe_unused]] static void TestFunction()
+
+#define INTERNAL_ASYNC_TEST_CASE(Description, Tags, TimeoutMs, TestFunction) \
+	static bool TestFunction(::cz::mut::detail::AsyncContext& czmutAsync); \
+	namespace { \
+		static const char CZMUT_CONCATENATE(desc_,TestFunction)[] PROGMEM = Description; \
+		static const char CZMUT_CONCATENATE(tags_,TestFunction)[] PROGMEM = Tags; \
+		::cz::mut::detail::AsyncSingleEntryTestCase<cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))> CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase) ( \
+			::cz::mut::registries::CZMUT_REGISTRY, \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(desc_, TestFunction), \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(tags_, TestFunction), \
+			F(__FILE__), &TestFunction, TimeoutMs); \
+	} \
+	static bool TestFunction([[maybe_unused]] ::cz::mut::detail::AsyncContext& czmutAsync)
+
+// Waits in a do/while, so the case label is part of the statement
+#define INTERNAL_ASYNC_WAIT_UNTIL(cond, line) \
+	do \
+	{ \
+		czmutAsync.resumePoint = line; \
+		[[fallthrough]]; \
+		case line: \
+		if (!(cond)) \
+			return false; \
+	} while(false)
+
+#define INTERNAL_ASYNC_YIELD(line) \
+	do \
+	{ \
+		czmutAsync.resumePoint = line; \
+		return false; \
+		case line:; \
+	} while(false)
+
+#if CZMUT_COROUTINES
+namespace cz::mut
+{
+	/*
+	* Return type of COROUTINE_TEST_CASE functions.
+	*/
+	class AsyncTask
+	{
+	public:
+		struct promise_type
+		{
+			// If set, the coroutine is waiting in waitUntil, and is only resumed once this returns true
+			bool (*readyFunc)(void*) = nullptr;
+			void* readyCtx = nullptr;
+
+			AsyncTask get_return_object()
+			{
+				return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { abort(); }
+		};
+
+		using Handle = std::coroutine_handle<promise_type>;
+
+		explicit AsyncTask(Handle handle)
+			: m_handle(handle)
+		{
+		}
+
+		AsyncTask(AsyncTask&& other)
+			: m_handle(other.m_handle)
+		{
+			other.m_handle = nullptr;
+		}
+
+		AsyncTask(const AsyncTask&) = delete;
+		AsyncTask& operator=(const AsyncTask&) = delete;
+
+		~AsyncTask()
+		{
+			if (m_handle)
+			{
+				m_handle.destroy();
+			}
+		}
+
+		// Releases ownership of the coroutine
+		Handle release()
+		{
+			Handle handle = m_handle;
+			m_handle = nullptr;
+			return handle;
+		}
+
+	private:
+		Handle m_handle;
+	};
+
+	template<typename Pred>
+	struct WaitUntilAwaiter
+	{
+		Pred pred;
+
+		bool await_ready()
+		{
+			return pred();
+		}
+
+		void await_suspend(AsyncTask::Handle handle)
+		{
+			handle.promise().readyFunc = [](void* ctx) { return (*static_cast<Pred*>(ctx))(); };
+			handle.promise().readyCtx = &pred;
+		}
+
+		void await_resume()
+		{
+		}
+	};
+
+	/*
+	* co_await on this suspends the test until the predicate returns true, letting the runner advance other tests
+	*/
+	template<typename Pred>
+	WaitUntilAwaiter<Pred> waitUntil(Pred pred)
+	{
+		return WaitUntilAwaiter<Pred>{ pred };
+	}
+
+	inline auto waitMs(unsigned long ms)
+	{
+		return waitUntil([start = getMillis(), ms]() { return (getMillis() - start) >= ms; });
+	}
+
+	// co_await on this suspends the test until the next time the runner polls it
+	inline std::suspend_always yield()
+	{
+		return {};
+	}
+}
+
+namespace cz::mut::detail
+{
+	template<AsyncTask(*Func)()>
+	bool resumeCoroutine(AsyncContext& ctx)
+	{
+		if (ctx.cancel)
+		{
+			if (ctx.resumePoint)
+			{
+				AsyncTask::Handle::from_address(ctx.coroutine).destroy();
+			}
+			return true;
+		}
+
+		if (ctx.resumePoint == 0)
+		{
+			ctx.coroutine = Func().release().address();
+			ctx.resumePoint = 1;
+		}
+
+		AsyncTask::Handle handle = AsyncTask::Handle::from_address(ctx.coroutine);
+		AsyncTask::promise_type& promise = handle.promise();
+		if (promise.readyFunc && !promise.readyFunc(promise.readyCtx))
+		{
+			return false;
+		}
+
+		promise.readyFunc = nullptr;
+		handle.resume();
+		if (handle.done())
+		{
+			handle.destroy();
+			return true;
+		}
+
+		return false;
+	}
+}
+
+#define INTERNAL_COROUTINE_TEST_CASE(Description, Tags, TimeoutMs, TestFunction, ResumeFunction) \
+	static ::cz::mut::AsyncTask TestFunction(); \
+	INTERNAL_ASYNC_TEST_CASE(Description, Tags, TimeoutMs, ResumeFunction) \
+	{ \
+		return ::cz::mut::detail::resumeCoroutine<&TestFunction>(czmutAsync); \
+	} \
+	static ::cz::mut::AsyncTask TestFunction()
+#endif
+
+#define INTERNAL_FUZZ_TEST(Description, Tags, TestFunction) \
+	static void TestFunction(const uint8_t* data, size_t size); \
+	namespace { \
+		static const char CZMUT_CONCATENATE(desc_,TestFunction)[] PROGMEM = Description; \
+		static const char CZMUT_CONCATENATE(tags_,TestFunction)[] PROGMEM = Tags; \
+		::cz::mut::detail::FuzzSingleEntryTestCase<cz::mut::containsAny(cz::mut::StaticString(Tags), cz::mut::StaticString(CZMUT_COMPILE_TIME_TAGS))> CZMUT_ANONYMOUS_VARIABLE(CZMUT_testcase) ( \
+			::cz::mut::registries::CZMUT_REGISTRY, \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(desc_, TestFunction), \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(tags_, TestFunction), \
+			&TestFunction); \
+	} \
+	static void TestFunction([[maybe_unused]] const uint8_t* data, [[maybe_unused]] size_t size)
+
+// The leading 0 makes sure we never declare a zero sized array, and is not part of the input
+#define INTERNAL_FUZZ_CORPUS(TestDescription, Description, DataName, ...) \
+	namespace { \
+		static const char CZMUT_CONCATENATE(test_,DataName)[] PROGMEM = TestDescription; \
+		static const char CZMUT_CONCATENATE(name_,DataName)[] PROGMEM = Description; \
+		static const uint8_t DataName[] PROGMEM = { 0, ## __VA_ARGS__ }; \
+		::cz::mut::detail::FuzzCorpusEntry CZMUT_CONCATENATE(entry_,DataName) ( \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(test_, DataName), \
+			(const __FlashStringHelper*) CZMUT_CONCATENATE(name_, DataName), \
+			DataName + 1, sizeof(DataName) - 1); \
+	}
+
+#define INTERNAL_EQUIVALENCE_TEST(Description, Tags, Reference, Optimized, MinSpeedup, EntryFunction, TestFunction) \
+	template<typename Equivalence> \
+	static void TestFunction(Equivalence& czmutEquivalence); \
+	INTERNAL_TEST_CASE(cz::mut::detail::SingleEntryTestCase, Description, Tags, EntryFunction) \
+	{ \
+		::cz::mut::detail::Equivalence<decltype(&Reference), decltype(&Optimized)> equivalence(&Reference, &Optimized, F(#Reference), F(#Optimized)); \
+		TestFunction(equivalence); \
+		equivalence.finish(cz::mut::getFilename(F(__FILE__)), __LINE__, (MinSpeedup)); \
+	} \
+	template<typename Equivalence> \
+	static void TestFunction([[maybe_unused]] Equivalence& czmutEquivalence)
+
 #define INTERNAL_CHECK(expr, file, line) \
 	cz::mut::detail::doCheck((expr), file, line, F(#expr))
 
@@ -590,14 +2510,204 @@ namespace cz::mut
 
 #define TEST_CASE(Description, Tags) INTERNAL_TEST_CASE(cz::mut::detail::SingleEntryTestCase, Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
 
+#define TEST_CASE_METHOD(Fixture, Description, Tags) \
+	INTERNAL_TEST_CASE_METHOD(Fixture, Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_FixtureTestCase), CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+
+#define ASYNC_TEST_CASE(Description, Tags, TimeoutMs) \
+	INTERNAL_ASYNC_TEST_CASE(Description, Tags, TimeoutMs, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+
+// Must be the first statement of an ASYNC_TEST_CASE
+#define ASYNC_BEGIN() \
+	if (czmutAsync.cancel) \
+		return true; \
+	switch (czmutAsync.resumePoint) \
+	{ \
+		case 0:
+
+// Must be the last statement of an ASYNC_TEST_CASE
+#define ASYNC_END() \
+	} \
+	return true
+
+#define ASYNC_WAIT_UNTIL(cond) INTERNAL_ASYNC_WAIT_UNTIL(cond, __LINE__)
+
+#define ASYNC_WAIT_MS(ms) \
+	do \
+	{ \
+		czmutAsync.timerStartMs = ::cz::mut::getMillis(); \
+		INTERNAL_ASYNC_WAIT_UNTIL((::cz::mut::getMillis() - czmutAsync.timerStartMs) >= (ms), __LINE__); \
+	} while(false)
+
+#define ASYNC_YIELD() INTERNAL_ASYNC_YIELD(__LINE__)
+
+#if CZMUT_COROUTINES
+	#define COROUTINE_TEST_CASE(Description, Tags, TimeoutMs) \
+		INTERNAL_COROUTINE_TEST_CASE(Description, Tags, TimeoutMs, CZMUT_ANONYMOUS_VARIABLE(CZMUT_coroutine), CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+#endif
+
+/*
+* A fuzz target. The body receives the input as "const uint8_t* data" and "size_t size", and uses CHECK/REQUIRE as
+* any other test.
+* When the tests run, it replays the inputs registered with FUZZ_CORPUS. With CZMUT_FUZZ, it's fed by libFuzzer instead.
+*/
+#define FUZZ_TEST(Description, Tags) \
+	INTERNAL_FUZZ_TEST(Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+
+/*
+* Adds an input (a list of bytes, which can be empty) to the corpus of the FUZZ_TEST with the specified name.
+* The input is kept in flash.
+*/
+#define FUZZ_CORPUS(TestDescription, Description, ...) \
+	INTERNAL_FUZZ_CORPUS(TestDescription, Description, CZMUT_ANONYMOUS_VARIABLE(CZMUT_corpus), ## __VA_ARGS__)
+
+/*
+* Checks that an optimized implementation gives the same results as a reference implementation, and how much faster it
+* is. The body feeds inputs to both with CHECK_EQUIVALENT.
+* Reference and Optimized are the names of the functions. The test fails if the optimized one is less than MinSpeedup
+* times faster (0 to only report the speedup).
+*/
+#define EQUIVALENCE_TEST(Description, Tags, Reference, Optimized, MinSpeedup) \
+	INTERNAL_EQUIVALENCE_TEST(Description, Tags, Reference, Optimized, MinSpeedup, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc), CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+
+// Calls both functions of an EQUIVALENCE_TEST with the specified arguments, and checks the results are equal
+#define CHECK_EQUIVALENT(...) \
+	czmutEquivalence.check(cz::mut::getFilename(F(__FILE__)), __LINE__, F("CHECK_EQUIVALENT(" #__VA_ARGS__ ")"), __VA_ARGS__)
+
+/*
+* A test that runs once per type, with the type available as TestType.
+* The types are either listed, or given as a single cz::mut::TypeList.
+*/
 #define TEMPLATED_TEST_CASE(Description, Tags, ...)  \
-	INTERNAL_TEMPLATED_TEST_CASE(CZMUT_ANONYMOUS_VARIABLE(CZMUT_TemplateTestCase), cz::mut::detail::TestCase, Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc), __VA_ARGS__)
+	INTERNAL_TEMPLATED_TEST_CASE(CZMUT_ANONYMOUS_VARIABLE(CZMUT_TemplateTestFuncs), Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc), __VA_ARGS__)
 	
+/*
+* Declares/defines a registry (see cz::mut::Registry), as cz::mut::registries::Name.
+* Use outside of any namespace.
+*/
+#define CZMUT_DECLARE_REGISTRY(Name) \
+	namespace cz::mut::registries { extern ::cz::mut::Registry Name; }
+
+#define CZMUT_DEFINE_REGISTRY(Name) \
+	namespace cz::mut::registries { ::cz::mut::Registry Name; }
+
+/*
+* A registry's tests only need to be linked if the application uses the registry. When the tests are in a static
+* library, the linker only takes the object files something refers to, so:
+* - Each file with tests for the registry names itself with CZMUT_REGISTRY_UNIT, after selecting the registry with
+*   CZMUT_REGISTRY.
+* - The file with CZMUT_DEFINE_REGISTRY refers to each of those with CZMUT_LINK_UNIT.
+* An application that never refers to the registry (e.g: by running it) doesn't link any of its tests.
+*/
+#define CZMUT_REGISTRY_UNIT(Unit) \
+	namespace cz::mut::registries::units \
+	{ \
+		extern const char CZMUT_CONCATENATE(CZMUT_REGISTRY, CZMUT_CONCATENATE(_, Unit)); \
+		const char CZMUT_CONCATENATE(CZMUT_REGISTRY, CZMUT_CONCATENATE(_, Unit)) = 0; \
+	}
+
+#define CZMUT_LINK_UNIT(Name, Unit) \
+	namespace cz::mut::registries::units \
+	{ \
+		extern const char Name##_##Unit; \
+		extern const char* const link_##Name##_##Unit; \
+		const char* const link_##Name##_##Unit = &Name##_##Unit; \
+	}
+
 #define SECTION(Description) INTERNAL_SECTION(Description, CZMUT_ANONYMOUS_VARIABLE(CZMUT_section))
 
 #define CHECK(expr) INTERNAL_CHECK(expr, cz::mut::getFilename(F(__FILE__)), __LINE__)
 
+/*
+* Checks a percentile of a LatencyHistogram. "comparison" is the rest of the expression, so
+* "CHECK_LATENCY(histogram, 99, <= 50)" checks that 99% of the recorded values are 50 us or less.
+*/
+#define CHECK_LATENCY(histogram, percentile, comparison) \
+	cz::mut::detail::doCheckLatency((histogram), (percentile), (histogram).valueAtPercentile(percentile) comparison, \
+		cz::mut::getFilename(F(__FILE__)), __LINE__, F("CHECK_LATENCY(" #histogram ", " #percentile ", " #comparison ")"))
+
+#define CHECK_LATENCY_P50(histogram, comparison) CHECK_LATENCY(histogram, 50, comparison)
+#define CHECK_LATENCY_P99(histogram, comparison) CHECK_LATENCY(histogram, 99, comparison)
+#define CHECK_LATENCY_P999(histogram, comparison) CHECK_LATENCY(histogram, 99.9, comparison)
+#define CHECK_LATENCY_MAX(histogram, comparison) CHECK_LATENCY(histogram, 100, comparison)
+
+/*
+* Checks the CRC32 of a buffer against the expected value. Useful for outputs too big to compare against a copy of the
+* expected data (e.g: rendered images, audio, serialized data).
+* With the record mode (see cz::mut::setDigestRecording), mismatches update the expected value in the source.
+*/
+#define CHECK_DIGEST(buffer, size, expected) \
+	cz::mut::detail::doCheckDigest(cz::mut::crc32((buffer), (size)), (expected), F(__FILE__), __LINE__, F("CHECK_DIGEST(" #buffer ", " #size ")"))
+
+// Same as CHECK_DIGEST, but for a cz::mut::Digest fed as the output was produced
+#define CHECK_DIGEST_STREAM(digest, expected) \
+	cz::mut::detail::doCheckDigest((digest).value(), (expected), F(__FILE__), __LINE__, F("CHECK_DIGEST_STREAM(" #digest ")"))
+
 #define REQUIRE(expr) INTERNAL_REQUIRE(expr, cz::mut::getFilename(F(__FILE__)), __LINE__)
 
-#define CZMUT_LOG(fmt,...) cz::mut::detail::logFmt(F(fmt), ## __VA_ARGS__)
+#if CZMUT_STATIC_TESTS_AT_RUNTIME
+	#define STATIC_TEST_CASE(Description, Tags) TEST_CASE(Description, Tags)
+	#define STATIC_CHECK(expr) CHECK(expr)
+	#define STATIC_REQUIRE(expr) REQUIRE(expr)
+#else
+	#define STATIC_TEST_CASE(Description, Tags) \
+		INTERNAL_STATIC_TEST_CASE(Description, Tags, CZMUT_ANONYMOUS_VARIABLE(CZMUT_staticreg), CZMUT_ANONYMOUS_VARIABLE(CZMUT_testfunc))
+	#define STATIC_CHECK(expr) static_assert((expr), "STATIC_CHECK( " #expr " ) failed")
+	#define STATIC_REQUIRE(expr) static_assert((expr), "STATIC_REQUIRE( " #expr " ) failed")
+#endif
+
+// Validates a format string against its arguments at compile time
+#define INTERNAL_CHECK_FORMAT(Macro, CheckName, fmt, ...) \
+	constexpr ::cz::mut::detail::FmtCheck CheckName = ::cz::mut::detail::checkFormat(::cz::mut::StaticString(fmt), decltype(::cz::mut::detail::fmtArgTypes(__VA_ARGS__))()); \
+	static_assert(CheckName != ::cz::mut::detail::FmtCheck::InvalidSpecifier, Macro ": Invalid or unsupported format specifier"); \
+	static_assert(CheckName != ::cz::mut::detail::FmtCheck::TooFewArguments, Macro ": The format string has more specifiers than arguments"); \
+	static_assert(CheckName != ::cz::mut::detail::FmtCheck::TooManyArguments, Macro ": The format string has less specifiers than arguments"); \
+	static_assert(CheckName != ::cz::mut::detail::FmtCheck::UnsupportedType, Macro ": Unsupported argument type"); \
+	static_assert(CheckName != ::cz::mut::detail::FmtCheck::TypeMismatch, Macro ": An argument's type doesn't match its format specifier")
+
+#define CZMUT_LOG(fmt,...) \
+	do \
+	{ \
+		INTERNAL_CHECK_FORMAT("CZMUT_LOG", CZMUT_fmtCheck, fmt, ## __VA_ARGS__); \
+		cz::mut::detail::logFmt(F(fmt), ## __VA_ARGS__); \
+	} while(false)
+
+/*
+* Same as CZMUT_LOG, but writes to a buffer, like snprintf. The output is truncated to fit, and is always null
+* terminated. Evaluates to the number of characters written.
+*/
+#define CZMUT_FORMAT(buf, bufSize, fmt, ...) \
+	[&]() \
+	{ \
+		INTERNAL_CHECK_FORMAT("CZMUT_FORMAT", CZMUT_fmtCheck, fmt, ## __VA_ARGS__); \
+		return cz::mut::detail::formatFmt((buf), (bufSize), F(fmt), ## __VA_ARGS__); \
+	}()
+
+#if CZMUT_INFO_CAPACITY
+	#define INTERNAL_INFO(CheckName, ScopeName, fmt, ...) \
+		INTERNAL_CHECK_FORMAT("INFO", CheckName, fmt, ## __VA_ARGS__); \
+		::cz::mut::detail::ScopedInfo ScopeName(F(fmt), false, ## __VA_ARGS__)
+
+	#define INTERNAL_CAPTURE(ScopeName, ...) \
+		::cz::mut::detail::ScopedInfo ScopeName(F(#__VA_ARGS__), true, __VA_ARGS__)
+#else
+	#define INTERNAL_INFO(CheckName, ScopeName, fmt, ...) \
+		INTERNAL_CHECK_FORMAT("INFO", CheckName, fmt, ## __VA_ARGS__)
+
+	#define INTERNAL_CAPTURE(ScopeName, ...) \
+		static_assert(true, "")
+#endif
+
+/*
+* Adds a message (same format as CZMUT_LOG) to the context logged if an assertion fails, until the end of the scope.
+* Nothing is formatted unless an assertion fails.
+*/
+#define INFO(fmt, ...) \
+	INTERNAL_INFO(CZMUT_ANONYMOUS_VARIABLE(CZMUT_infoCheck), CZMUT_ANONYMOUS_VARIABLE(CZMUT_info), fmt, ## __VA_ARGS__)
+
+/*
+* Adds the values of the specified variables or expressions to the context logged if an assertion fails, until the end
+* of the scope.
+*/
+#define CAPTURE(...) \
+	INTERNAL_CAPTURE(CZMUT_ANONYMOUS_VARIABLE(CZMUT_capture), __VA_ARGS__)
 
@@ -0,0 +1,196 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#if CZMUT_THREADS
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace cz::mut
+{
+
+namespace
+{
+
+// Random yields of the current thread. yieldChance is 0 outside cz::mut::stress
+thread_local uint32_t gYieldState;
+thread_local unsigned int gYieldChance;
+
+long long nowNs()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+* The threads spin instead of sleeping on a condition variable, so they all wake up at the same time when a round
+* starts, which is what makes them collide.
+* The thread that called stress acts as the coordinator: It waits for all the threads to arrive, and then starts the
+* next round. Since the threads are all waiting at that point, it can safely look at the results.
+*/
+class StressBarrier
+{
+public:
+	explicit StressBarrier(int threads)
+		: m_threads(threads)
+		// Spinning is only useful if there are enough cores for all the threads. Otherwise it just keeps the thread
+		// that would complete the barrier from running
+		, m_maxSpins(threads < static_cast<int>(std::thread::hardware_concurrency()) ? 1000 : 0)
+	{
+	}
+
+	// Called by the threads at the end of a round. Returns false if they should stop
+	bool arriveAndWait()
+	{
+		unsigned int round = m_round.load(std::memory_order_relaxed);
+		m_arrived.fetch_add(1, std::memory_order_acq_rel);
+		for (int spins = 0; m_round.load(std::memory_order_acquire) == round; spins++)
+		{
+			if (spins >= m_maxSpins)
+			{
+				std::this_thread::yield();
+			}
+		}
+		return !m_stop.load(std::memory_order_relaxed);
+	}
+
+	// Called by the coordinator
+	void waitForAll()
+	{
+		while (m_arrived.load(std::memory_order_acquire) != m_threads)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Called by the coordinator, after waitForAll
+	void release(bool stop)
+	{
+		m_arrived.store(0, std::memory_order_relaxed);
+		m_stop.store(stop, std::memory_order_relaxed);
+		m_round.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+	const int m_threads;
+	const int m_maxSpins;
+	std::atomic<int> m_arrived {0};
+	std::atomic<unsigned int> m_round {0};
+	std::atomic<bool> m_stop {false};
+};
+
+} // anonymous namespace
+
+void stressYield()
+{
+	if (gYieldChance)
+	{
+		// xorshift32
+		uint32_t x = gYieldState;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		gYieldState = x;
+		if (x % gYieldChance == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+namespace detail
+{
+
+StressResult stress(int threads, unsigned long iterations, const StressOptions& options, StressFunction stressFunc, const void* func)
+{
+	if (threads <= 0)
+	{
+		threads = static_cast<int>(std::thread::hardware_concurrency());
+		threads = threads ? threads : 2;
+	}
+
+	unsigned long roundSize = options.roundSize ? options.roundSize : iterations;
+	unsigned long rounds = roundSize ? (iterations + roundSize - 1) / roundSize : 0;
+
+	StressBarrier barrier(threads);
+	// Written by each thread before it arrives at a barrier, so the coordinator can read them after waitForAll
+	std::vector<unsigned long> done(threads, 0);
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (int i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			gYieldState = (options.seed + i) * 2654435761u;
+			// xorshift32 gets stuck at 0
+			gYieldState = gYieldState ? gYieldState : 1;
+			gYieldChance = options.yieldChance;
+
+			unsigned long iteration = 0;
+			while (barrier.arriveAndWait() && iteration < iterations)
+			{
+				unsigned long end = iterations - iteration > roundSize ? iteration + roundSize : iterations;
+				for (; iteration < end; iteration++)
+				{
+					stressYield();
+					stressFunc(func, i, iteration);
+				}
+				done[i] = iteration;
+			}
+
+			gYieldChance = 0;
+		});
+	}
+
+	int failedBefore = getSummary().assertionsFailed;
+	StressResult result = {};
+
+	// Wait for all threads to be ready, so the first round starts at the same time for all of them
+	barrier.waitForAll();
+	long long start = nowNs();
+	for (unsigned long round = 0; round < rounds; round++)
+	{
+		barrier.release(false);
+		barrier.waitForAll();
+		result.assertionsFailed = getSummary().assertionsFailed - failedBefore;
+		if (result.assertionsFailed && options.stopOnFailure)
+		{
+			break;
+		}
+	}
+	result.durationNs = nowNs() - start;
+	barrier.release(true);
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (unsigned long count : done)
+	{
+		result.iterations += count;
+	}
+	result.assertionsFailed = getSummary().assertionsFailed - failedBefore;
+
+	if (result.assertionsFailed && getVerbosity() >= Verbosity::Failures)
+	{
+		CZMUT_LOG("STRESS: %d assertions failed after %llu iterations\n", result.assertionsFailed, result.iterations);
+	}
+
+	if (getVerbosity() >= Verbosity::Normal)
+	{
+		CZMUT_LOG("STRESS: %d threads, %llu iterations in %.3f ms. %.0f iterations/s\n",
+			threads, result.iterations, result.durationNs / 1e6, result.iterationsPerSecond());
+	}
+
+	return result;
+}
+
+} // namespace detail
+
+} // namespace cz::mut
+
+#endif
@@ -0,0 +1,193 @@
+#define CZMUT_SKIP_CPP17_CHECK
+#include <crazygaze/mut/mut.h>
+#undef CZMUT_SKIP_CPP17_CHECK
+
+#if CZMUT_LISTENERS && CZMUT_DESKTOP
+
+#include <chrono>
+#if CZMUT_THREADS
+	#include <mutex>
+#endif
+
+namespace cz::mut
+{
+
+namespace
+{
+
+long long nowNs()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#if CZMUT_THREADS
+// Failed assertions can come from the test's threads
+std::mutex gTraceMutex;
+	#define CZMUT_TRACE_LOCK std::lock_guard<std::mutex> lock(gTraceMutex)
+#else
+	#define CZMUT_TRACE_LOCK do {} while(false)
+#endif
+
+void writeEscaped(FILE* f, const char* str)
+{
+	for (; *str; str++)
+	{
+		unsigned char ch = static_cast<unsigned char>(*str);
+		if (ch == '"' || ch == '\\')
+		{
+			fputc('\\', f);
+			fputc(ch, f);
+		}
+		else if (ch < 0x20)
+		{
+			fprintf(f, "\\u%04x", ch);
+		}
+		else
+		{
+			fputc(ch, f);
+		}
+	}
+}
+
+} // anonymous namespace
+
+ChromeTraceListener::ChromeTraceListener(const char* file)
+	: m_file(fopen(file, "w"))
+	, m_startNs(nowNs())
+{
+	if (!m_file)
+	{
+		CZMUT_LOG("TRACE: Can't write to file %s\n", file);
+		return;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", m_file);
+	addListener(*this);
+}
+
+ChromeTraceListener::~ChromeTraceListener()
+{
+	if (!m_file)
+	{
+		return;
+	}
+
+	removeListener(*this);
+	fputs("\n]}\n", m_file);
+	fclose(m_file);
+}
+
+void ChromeTraceListener::beginEvent(char phase, const char* category)
+{
+	fputs(m_firstEvent ? "\n" : ",\n", m_file);
+	m_firstEvent = false;
+	// Timestamps are in microseconds
+	fprintf(m_file, "{\"ph\":\"%c\",\"cat\":\"%s\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"name\":\"",
+		phase, category, static_cast<double>(nowNs() - m_startNs) / 1000.0);
+}
+
+void ChromeTraceListener::writeEvent(char phase, const char* category, const char* name, const char* typeName, const void* asyncId)
+{
+	CZMUT_TRACE_LOCK;
+	beginEvent(phase, category);
+	writeEscaped(m_file, name);
+	if (typeName)
+	{
+		fputc('<', m_file);
+		writeEscaped(m_file, typeName);
+		fputc('>', m_file);
+	}
+	fputc('"', m_file);
+	if (asyncId)
+	{
+		fprintf(m_file, ",\"id\":\"%p\"", asyncId);
+	}
+	fputc('}', m_file);
+}
+
+void ChromeTraceListener::onTestStart(const detail::TestCase& test)
+{
+	// Async tests overlap with other tests, so they can't be nested with them
+	if (test.isAsync())
+	{
+		writeEvent('b', "async", test.getName(), nullptr, &test);
+	}
+	else
+	{
+		writeEvent('B', "test", test.getName());
+	}
+}
+
+void ChromeTraceListener::onTestEnd(const detail::TestCase& test)
+{
+	if (test.isAsync())
+	{
+		writeEvent('e', "async", test.getName(), nullptr, &test);
+	}
+	else
+	{
+		writeEvent('E', "test", test.getName());
+	}
+}
+
+void ChromeTraceListener::onEntryStart(const detail::TestCase& test, const __FlashStringHelper* typeName)
+{
+	// Only templated tests have more than one entry, so other entries would be the same as the test
+	if (typeName)
+	{
+		writeEvent('B', "entry", test.getName(), typeName);
+	}
+}
+
+void ChromeTraceListener::onEntryEnd(const detail::TestCase& test, const __FlashStringHelper* typeName)
+{
+	if (typeName)
+	{
+		writeEvent('E', "entry", test.getName(), typeName);
+	}
+}
+
+void ChromeTraceListener::onSectionEnter(const detail::Section& section)
+{
+	if (section.getParent())
+	{
+		writeEvent('B', "section", section.getName());
+	}
+	else
+	{
+		writeEvent('B', "pass", "Pass");
+	}
+}
+
+void ChromeTraceListener::onSectionExit(const detail::Section& section)
+{
+	if (section.getParent())
+	{
+		writeEvent('E', "section", section.getName());
+	}
+	else
+	{
+		writeEvent('E', "pass", "Pass");
+	}
+}
+
+void ChromeTraceListener::onAssertion(const __FlashStringHelper* file, int line, const __FlashStringHelper* expr, bool passed)
+{
+	if (passed)
+	{
+		return;
+	}
+
+	CZMUT_TRACE_LOCK;
+	beginEvent('i', "assertion");
+	fputs("FAILED: ", m_file);
+	writeEscaped(m_file, expr ? expr : "");
+	fputs("\",\"s\":\"g\",\"args\":{\"location\":\"", m_file);
+	writeEscaped(m_file, file);
+	fprintf(m_file, ":%d\"}}", line);
+}
+
+} // namespace cz::mut
+
+#endif
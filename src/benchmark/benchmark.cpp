@@ -0,0 +1,253 @@
+/*
+czmut self-benchmark.
+
+Measures the framework's own costs (registration, filtering, assertions, section re-execution), and reports the size
+of the main internal structures and the flash/RAM footprint of tests and assertions.
+
+czmut's own output is sent to the null device, so the console doesn't distort the timings, and the report is written
+to stderr.
+*/
+
+#include "benchmark_common.h"
+#include "footprint.h"
+
+#if !CZMUT_DESKTOP
+	#error The benchmark is only supported on desktop platforms
+#endif
+
+#include <chrono>
+#include <memory>
+#include <new>
+
+using namespace cz::mut;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+struct SuiteInfo
+{
+	const char* name;
+	Clock::time_point begin;
+	double seconds;
+	int numTests;
+};
+
+// Zero initialized, since the markers run during static initialization
+SuiteInfo gSuites[8];
+int gNumSuites;
+
+// Gives access to the filtering, without running the tests
+struct FilterAccess : public detail::TestCase
+{
+	using TestCase::filter;
+};
+
+using FlatTestCase = detail::SingleEntryTestCase<true>;
+
+volatile int gValue = 1;
+
+void flatTest()
+{
+	CHECK(gValue > 0);
+	CHECK(gValue < 10);
+}
+
+double toSeconds(Clock::duration d)
+{
+	return std::chrono::duration<double>(d).count();
+}
+
+void reportHeader(const char* title)
+{
+	fprintf(stderr, "\n%s\n", title);
+}
+
+void reportTime(const char* what, double seconds, long long count, const char* unit)
+{
+	fprintf(stderr, "    %-48s %10.3f ms total, %10.1f ns/%s (%lld)\n", what, seconds * 1000.0, seconds * 1e9 / (count ? count : 1), unit, count);
+}
+
+void reportFootprint(const char* what, int valueX100)
+{
+	if (valueX100 < 0)
+		fprintf(stderr, "    %-48s unknown (no size tool found)\n", what);
+	else
+		fprintf(stderr, "    %-48s %7.2f bytes\n", what, valueX100 / 100.0);
+}
+
+SuiteInfo* findSuite(const char* name)
+{
+	for (int i = 0; i < gNumSuites; i++)
+	{
+		if (strcmp(gSuites[i].name, name) == 0)
+			return &gSuites[i];
+	}
+	return nullptr;
+}
+
+int countRegisteredTests()
+{
+	FilterAccess::filter(detail::FlashStringIterator(nullptr));
+	return detail::TestCase::countEnabledTests();
+}
+
+// Runs a suite and reports the time per test and per section pass (each leaf section means a new pass)
+void benchRun(const char* name, const __FlashStringHelper* tags, int numTests, int passesPerTest)
+{
+	auto start = Clock::now();
+	run(tags);
+	double seconds = toSeconds(Clock::now() - start);
+
+	fprintf(stderr, "  %s: %d tests, %d passes, %d assertions\n", name, numTests, numTests * passesPerTest, detail::gResults.assertions);
+	reportTime("run", seconds, numTests, "test");
+	reportTime("run", seconds, (long long)numTests * passesPerTest, "pass");
+	reportTime("run", seconds, detail::gResults.assertions, "assertion");
+}
+
+} // anonymous namespace
+
+namespace cz::mut::bench
+{
+	SuiteMarker::SuiteMarker(const char* name, bool begin)
+	{
+		if (begin)
+		{
+			SuiteInfo& info = gSuites[gNumSuites++];
+			info.name = name;
+			info.begin = Clock::now();
+			info.numTests = countRegisteredTests();
+		}
+		else
+		{
+			SuiteInfo* info = findSuite(name);
+			info->seconds = toSeconds(Clock::now() - info->begin);
+			info->numTests = countRegisteredTests() - info->numTests;
+		}
+	}
+}
+
+int main()
+{
+	constexpr int NumFlatTests = 100000;
+	constexpr int PassesPerGeneratedTest = 1 << CZMUT_BENCH_SECTION_DEPTH;
+
+#if defined(_WIN32)
+	freopen("NUL", "w", stdout);
+#else
+	freopen("/dev/null", "w", stdout);
+#endif
+
+	reportHeader("Sizes");
+	fprintf(stderr, "    %-48s %4d bytes\n", "sizeof(TestCase)", int(sizeof(detail::TestCase)));
+	fprintf(stderr, "    %-48s %4d bytes\n", "sizeof(TestCase::Entry)", int(sizeof(detail::TestCase::Entry)));
+	fprintf(stderr, "    %-48s %4d bytes\n", "sizeof(Section)", int(sizeof(detail::Section)));
+	fprintf(stderr, "    %-48s %4d bytes\n", "sizeof(SingleEntryTestCase<true>)", int(sizeof(FlatTestCase)));
+
+	reportHeader("Footprint (measured on the host toolchain's object files)");
+	reportFootprint("Flash per test", CZMUT_BENCH_FLASH_PER_TEST_X100);
+	reportFootprint("RAM per test", CZMUT_BENCH_RAM_PER_TEST_X100);
+	reportFootprint("Flash per CHECK", CZMUT_BENCH_FLASH_PER_CHECK_X100);
+	reportFootprint("RAM per CHECK", CZMUT_BENCH_RAM_PER_CHECK_X100);
+
+	//
+	// Registration
+	//
+	reportHeader("Registration");
+	for (int i = 0; i < gNumSuites; i++)
+	{
+		reportTime(gSuites[i].name, gSuites[i].seconds, gSuites[i].numTests, "test");
+	}
+
+	// The 100k suite is created at runtime, since compiling that many tests takes too long.
+	// Its tests don't have sections, because all the tests share the same function (and thus the same static sections).
+	struct Storage
+	{
+		alignas(FlatTestCase) unsigned char data[sizeof(FlatTestCase)];
+	};
+	std::unique_ptr<Storage[]> storage(new Storage[NumFlatTests]);
+	{
+		auto start = Clock::now();
+		for (int i = 0; i < NumFlatTests; i++)
+		{
+			new (storage[i].data) FlatTestCase(registries::global, F("gen100k test"), F("[bench][gen100k]"), &flatTest);
+		}
+		reportTime("gen100k", toSeconds(Clock::now() - start), NumFlatTests, "test");
+	}
+
+	int totalTests = countRegisteredTests();
+
+	//
+	// Filtering
+	//
+	reportHeader("Filtering");
+	fprintf(stderr, "  Registered tests: %d\n", totalTests);
+	const __FlashStringHelper* expressions[] =
+	{
+		F("[gen10]"),
+		F("~[gen100k]"),
+		F("[bench][gen10],[bench][gen1k]"),
+		F("[nomatch][bench][gen1k],~[gen100k][bench],[gen10][bench][nomatch2],[gen1k]"),
+		// Name patterns. Exact names and IDs use the name index
+		F("gen1k test 500"),
+		F("#50000"),
+		F("gen1k test 5*")
+	};
+	for (const __FlashStringHelper* expr : expressions)
+	{
+		constexpr int Iterations = 20;
+		auto start = Clock::now();
+		for (int i = 0; i < Iterations; i++)
+		{
+			FilterAccess::filter(detail::FlashStringIterator(expr));
+		}
+		double seconds = toSeconds(Clock::now() - start);
+		fprintf(stderr, "  \"%s\"\n", reinterpret_cast<const char*>(expr));
+		reportTime("filter", seconds / Iterations, totalTests, "test");
+	}
+
+	//
+	// Assertions
+	//
+	reportHeader("Assertions");
+	{
+		constexpr int Iterations = 10000000;
+		volatile int sink = 0;
+
+		auto start = Clock::now();
+		for (int i = 0; i < Iterations; i++)
+		{
+			sink = (gValue > 0);
+		}
+		double baseline = toSeconds(Clock::now() - start);
+
+		start = Clock::now();
+		for (int i = 0; i < Iterations; i++)
+		{
+			CHECK(gValue > 0);
+		}
+		double checks = toSeconds(Clock::now() - start);
+		reportTime("CHECK overhead (excluding the expression)", checks - baseline, Iterations, "check");
+		(void)sink;
+	}
+
+	//
+	// Running, including section re-execution
+	//
+	reportHeader("Running");
+	const SuiteInfo* gen10 = findSuite("gen10");
+	const SuiteInfo* gen1k = findSuite("gen1k");
+	benchRun("gen10", F("[gen10]"), gen10->numTests, PassesPerGeneratedTest);
+	benchRun("gen1k", F("[gen1k]"), gen1k->numTests, PassesPerGeneratedTest);
+	benchRun("gen100k (no sections)", F("[gen100k]"), NumFlatTests, 1);
+
+	// Same, but without the per test progress lines
+	reportHeader("Running (quiet)");
+	setVerbosity(Verbosity::Quiet);
+	benchRun("gen1k", F("[gen1k]"), gen1k->numTests, PassesPerGeneratedTest);
+	benchRun("gen100k (no sections)", F("[gen100k]"), NumFlatTests, 1);
+	setVerbosity(Verbosity::Normal);
+
+	fprintf(stderr, "\n");
+	return EXIT_SUCCESS;
+}
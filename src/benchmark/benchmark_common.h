@@ -0,0 +1,20 @@
+#pragma once
+
+#include <crazygaze/mut/mut.h>
+
+// Required to facilitate compile time test case filtering (see documentation)
+#ifndef CZMUT_COMPILE_TIME_TAGS
+	#define CZMUT_COMPILE_TIME_TAGS ""
+#endif
+
+namespace cz::mut::bench
+{
+	/*
+	* Static initialization inside a translation unit follows the declaration order, so the generated suites put one
+	* marker before and one after all the tests, which gives us how long it took to register those tests.
+	*/
+	struct SuiteMarker
+	{
+		SuiteMarker(const char* name, bool begin);
+	};
+}
@@ -0,0 +1,41 @@
+#
+# Script mode (cmake -P) helper that measures the flash and RAM footprint of tests and assertions, by comparing the
+# size of the "footprint" libraries, and generates a header with the results for the benchmark to report.
+#
+# Expected variables:
+#	SIZE_TOOL : Path to a binutils compatible "size" tool. Can be empty, in which case the results are reported as unknown
+#	BASE_LIB : Library with no tests
+#	TESTS_LIB : Library with NUM_TESTS empty tests
+#	CHECKS_LIB : Library with NUM_TESTS tests, each with NUM_CHECKS CHECKs
+#	NUM_TESTS
+#	NUM_CHECKS
+#	OUTPUT : Header file to generate
+#
+
+include("${CMAKE_CURRENT_LIST_DIR}/../../lib/cmake/size.cmake")
+
+if(SIZE_TOOL)
+	czmut_get_size("${SIZE_TOOL}" "${BASE_LIB}" base_flash base_ram)
+	czmut_get_size("${SIZE_TOOL}" "${TESTS_LIB}" tests_flash tests_ram)
+	czmut_get_size("${SIZE_TOOL}" "${CHECKS_LIB}" checks_flash checks_ram)
+
+	# Multiplying by 100 to keep 2 decimal places, since CMake's math only does integers
+	math(EXPR flash_per_test "(${tests_flash} - ${base_flash}) * 100 / ${NUM_TESTS}")
+	math(EXPR ram_per_test "(${tests_ram} - ${base_ram}) * 100 / ${NUM_TESTS}")
+	math(EXPR flash_per_check "(${checks_flash} - ${tests_flash}) * 100 / (${NUM_TESTS} * ${NUM_CHECKS})")
+	math(EXPR ram_per_check "(${checks_ram} - ${tests_ram}) * 100 / (${NUM_TESTS} * ${NUM_CHECKS})")
+else()
+	set(flash_per_test -100)
+	set(ram_per_test -100)
+	set(flash_per_check -100)
+	set(ram_per_check -100)
+endif()
+
+set(content "// Generated by czmut's benchmark footprint script. Do not edit.\n")
+string(APPEND content "#pragma once\n\n")
+string(APPEND content "// Values are multiplied by 100. Negative values mean the footprint couldn't be measured\n")
+string(APPEND content "#define CZMUT_BENCH_FLASH_PER_TEST_X100 ${flash_per_test}\n")
+string(APPEND content "#define CZMUT_BENCH_RAM_PER_TEST_X100 ${ram_per_test}\n")
+string(APPEND content "#define CZMUT_BENCH_FLASH_PER_CHECK_X100 ${flash_per_check}\n")
+string(APPEND content "#define CZMUT_BENCH_RAM_PER_CHECK_X100 ${ram_per_check}\n")
+file(WRITE "${OUTPUT}" "${content}")
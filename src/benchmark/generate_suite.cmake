@@ -0,0 +1,91 @@
+
+#
+# Generates a test suite source file with "num_tests" tests.
+# Each test has a full SECTION tree of the specified depth (2 children per section) and "num_checks" CHECKs per section.
+#
+function(czmut_bench_generate_suite out_file suite_name num_tests depth num_checks)
+
+	set(content "// Generated by czmut's benchmark CMake script. Do not edit.\n")
+	string(APPEND content "#include \"benchmark_common.h\"\n\n")
+	string(APPEND content "static cz::mut::bench::SuiteMarker gSuiteBegin_${suite_name}(\"${suite_name}\", true);\n\n")
+
+	# Build the body of a test once, since all tests have the same shape
+	set(body "")
+	_czmut_bench_generate_section(body "" 1 ${depth} ${num_checks} "\t")
+
+	math(EXPR last "${num_tests} - 1")
+	foreach(idx RANGE ${last})
+		string(APPEND content "TEST_CASE(\"${suite_name} test ${idx}\", \"[bench][${suite_name}]\")\n{\n")
+		string(APPEND content "\tint value = ${idx};\n")
+		string(APPEND content "${body}")
+		string(APPEND content "}\n\n")
+	endforeach()
+
+	string(APPEND content "static cz::mut::bench::SuiteMarker gSuiteEnd_${suite_name}(\"${suite_name}\", false);\n")
+
+	# Only touch the file if the contents changed, to avoid needless rebuilds
+	if(EXISTS "${out_file}")
+		file(READ "${out_file}" old_content)
+	endif()
+	if(NOT "${old_content}" STREQUAL "${content}")
+		file(WRITE "${out_file}" "${content}")
+	endif()
+
+endfunction()
+
+function(_czmut_bench_generate_section out_var prefix level depth num_checks indent)
+
+	set(res "")
+	foreach(idx RANGE 1 ${num_checks})
+		string(APPEND res "${indent}CHECK(value + ${idx} > value);\n")
+	endforeach()
+
+	if(level LESS_EQUAL depth)
+		foreach(child 0 1)
+			set(name "${prefix}${child}")
+			string(APPEND res "${indent}SECTION(\"section ${name}\")\n${indent}{\n")
+			string(APPEND res "${indent}\tvalue++;\n")
+			math(EXPR next_level "${level} + 1")
+			set(child_body "")
+			_czmut_bench_generate_section(child_body "${name}." ${next_level} ${depth} ${num_checks} "${indent}\t")
+			string(APPEND res "${child_body}")
+			string(APPEND res "${indent}}\n")
+		endforeach()
+	endif()
+
+	set(${out_var} "${${out_var}}${res}" PARENT_SCOPE)
+
+endfunction()
+
+#
+# Generates a source file with "num_tests" tests, each with "num_checks" CHECKs and no sections.
+# Used to measure the flash and RAM footprint of tests and assertions.
+#
+function(czmut_bench_generate_footprint out_file num_tests num_checks)
+
+	set(content "// Generated by czmut's benchmark CMake script. Do not edit.\n")
+	string(APPEND content "#include <crazygaze/mut/mut.h>\n\n")
+	string(APPEND content "#ifndef CZMUT_COMPILE_TIME_TAGS\n\t#define CZMUT_COMPILE_TIME_TAGS \"\"\n#endif\n\n")
+	string(APPEND content "extern volatile int gFootprintValue;\n\n")
+
+	if(num_tests GREATER 0)
+		math(EXPR last "${num_tests} - 1")
+		foreach(idx RANGE ${last})
+			string(APPEND content "TEST_CASE(\"footprint test ${idx}\", \"[footprint]\")\n{\n")
+			if(num_checks GREATER 0)
+				foreach(check RANGE 1 ${num_checks})
+					string(APPEND content "\tCHECK(gFootprintValue != ${check});\n")
+				endforeach()
+			endif()
+			string(APPEND content "}\n\n")
+		endforeach()
+	endif()
+
+	if(EXISTS "${out_file}")
+		file(READ "${out_file}" old_content)
+	endif()
+	if(NOT "${old_content}" STREQUAL "${content}")
+		file(WRITE "${out_file}" "${content}")
+	endif()
+
+endfunction()
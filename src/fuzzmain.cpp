@@ -0,0 +1,10 @@
+#include <crazygaze/mut/mut.h>
+
+/*
+Built with CZMUT_FUZZ, so there is no main function. libFuzzer provides one, and calls the fuzz target through
+LLVMFuzzerTestOneInput.
+Example, to grow the checked in corpus:
+	examples_fuzzer_Debug ../lib/examples/corpus/varint
+If there is more than one FUZZ_TEST, set the CZMUT_FUZZ_TEST environment variable to the name of the one to fuzz.
+*/
+#include "../lib/examples/example_fuzz.h"
@@ -11,9 +11,22 @@ Note that files with tests should normally be in a cpp file. Tests create global
 framework, so no #include directives are needed.
 Here, I'm using #include just to make it easier during development of the library.
 */
+#include "../lib/examples/example_arena.h"
+#include "../lib/examples/example_async.h"
 #include "../lib/examples/example_basic.h"
+#include "../lib/examples/example_digest.h"
+#include "../lib/examples/example_equivalence.h"
+#include "../lib/examples/example_fixtures.h"
+#include "../lib/examples/example_fuzz.h"
+#include "../lib/examples/example_info.h"
+#include "../lib/examples/example_isolation.h"
+#include "../lib/examples/example_latency.h"
+#include "../lib/examples/example_registry.h"
 #include "../lib/examples/example_sections.h"
+#include "../lib/examples/example_static.h"
+#include "../lib/examples/example_stress.h"
 #include "../lib/examples/example_templated.h"
+#include "../lib/examples/example_threads.h"
 
 #if CZMUT_ARDUINO
 
@@ -31,19 +44,52 @@ void setup() {
 		; // wait for serial port to connect. Needed for native USB port only
 	}
 
-	cz::mut::run(F("[example]"));
+	cz::mut::begin(F("[example]"));
 }
 
 void loop() {
-	//
+	// Runs a bit of the tests per loop, so anything else in the loop still gets to run
+	// Alternatively, call cz::mut::pollCommands() here instead of begin/step, to choose what to run over serial
+	cz::mut::step();
 }
 
 
 #elif CZMUT_DESKTOP
 
-int main()
+int main(int argc, char* argv[])
 {
-	return cz::mut::run("[example]") ? EXIT_SUCCESS : EXIT_FAILURE;
+#if CZMUT_ISOLATION
+	// Each batch of tests runs in a child process, so a crash doesn't stop the run
+	if (argc > 1 && strcmp(argv[1], "--isolated") == 0)
+	{
+		return cz::mut::runIsolated("[example]") ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Runs the tests that crash on purpose (see example_isolation.h), and checks they were all caught
+	if (argc > 1 && strcmp(argv[1], "--isolation-example") == 0)
+	{
+		cz::mut::IsolationOptions options;
+		options.batchSize = 4;
+		bool passed = cz::mut::runIsolated("[isolation]", options);
+		cz::mut::Summary summary = cz::mut::getSummary();
+		return !passed && summary.testsRan == 6 && summary.testsFailed == 3 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+#endif
+
+	// Reads commands from stdin (e.g: "run [basic]"). See the documentation
+	if (argc > 1 && strcmp(argv[1], "--commands") == 0)
+	{
+		while (cz::mut::pollCommands())
+		{
+		}
+		return cz::mut::getSummary().passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// The suite of a library with its own registry (see example_registry.h), followed by the examples.
+	// CZMUT_COMPILE_TIME_TAGS can leave the library's suite empty (e.g: in a partition's image)
+	bool passed = cz::mut::registries::example_lib.getCount() == 0 || cz::mut::run(cz::mut::registries::example_lib);
+	passed = cz::mut::run("[example]") && passed;
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 #else
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace mylib
+{
+	inline int clamp(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	// Wraps value to [0, size)
+	inline int wrap(int value, int size)
+	{
+		int res = value % size;
+		return res < 0 ? res + size : res;
+	}
+}
@@ -0,0 +1,15 @@
+#define CZMUT_REGISTRY mylib
+#include <crazygaze/mut/mut.h>
+#include "mylib.h"
+
+CZMUT_DECLARE_REGISTRY(mylib)
+
+TEST_CASE("mylib clamp", "[mylib]")
+{
+	CHECK(mylib::clamp(5, 0, 10) == 5);
+	CHECK(mylib::clamp(-5, 0, 10) == 0);
+	CHECK(mylib::clamp(15, 0, 10) == 10);
+}
+
+// So mylib_registry.cpp can refer to this file, and the linker takes it along with the registry
+CZMUT_REGISTRY_UNIT(clamp)
@@ -0,0 +1,6 @@
+#include <crazygaze/mut/mut.h>
+
+// Anything that refers to the registry links this file, which in turn links all the files with the registry's tests
+CZMUT_DEFINE_REGISTRY(mylib)
+CZMUT_LINK_UNIT(mylib, clamp)
+CZMUT_LINK_UNIT(mylib, wrap)
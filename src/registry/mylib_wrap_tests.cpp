@@ -0,0 +1,14 @@
+#define CZMUT_REGISTRY mylib
+#include <crazygaze/mut/mut.h>
+#include "mylib.h"
+
+CZMUT_DECLARE_REGISTRY(mylib)
+
+TEST_CASE("mylib wrap", "[mylib]")
+{
+	CHECK(mylib::wrap(3, 10) == 3);
+	CHECK(mylib::wrap(13, 10) == 3);
+	CHECK(mylib::wrap(-3, 10) == 7);
+}
+
+CZMUT_REGISTRY_UNIT(wrap)
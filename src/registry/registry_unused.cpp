@@ -0,0 +1,19 @@
+#include <crazygaze/mut/mut.h>
+
+// Weak, so it doesn't make the linker take the registry from the library. It's null if nothing else did
+namespace cz::mut::registries
+{
+	extern Registry mylib __attribute__((weak));
+}
+
+TEST_CASE("Registry unused", "[registry]")
+{
+	// Nothing refers to the library's registry, so neither the registry nor its tests were linked
+	CHECK(&cz::mut::registries::mylib == nullptr);
+	CHECK(cz::mut::registries::global.getCount() == 1);
+}
+
+int main()
+{
+	return cz::mut::run(F("[registry]")) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,18 @@
+#include <crazygaze/mut/mut.h>
+
+CZMUT_DECLARE_REGISTRY(mylib)
+
+TEST_CASE("Registry used", "[registry]")
+{
+	// Running the registry links all of its tests, even if nothing refers to the test files
+	CHECK(cz::mut::registries::mylib.getCount() == 2);
+}
+
+int main()
+{
+	bool passed = cz::mut::run(cz::mut::registries::mylib);
+
+	// The library's registry was only selected while its suite ran, so this runs the application's own tests
+	passed = cz::mut::run(F("[registry]")) && passed;
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}